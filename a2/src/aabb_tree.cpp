@@ -0,0 +1,280 @@
+// internal
+#include "aabb_tree.hpp"
+
+const int AABBTree::NULL_NODE;
+constexpr float AABBTree::AABB_MARGIN;
+constexpr float AABBTree::DISPLACEMENT_MULTIPLIER;
+
+AABBTree::AABBTree()
+	: root(NULL_NODE)
+	, free_list(NULL_NODE)
+	, leaf_count(0)
+{
+}
+
+void AABBTree::clear()
+{
+	nodes.clear();
+	root = NULL_NODE;
+	free_list = NULL_NODE;
+	leaf_count = 0;
+}
+
+int AABBTree::allocate_node()
+{
+	// Grow the node pool if the free list is empty
+	if (free_list == NULL_NODE)
+	{
+		nodes.push_back(Node());
+		nodes.back().parent = NULL_NODE;
+		free_list = (int)nodes.size() - 1;
+	}
+
+	int node_id = free_list;
+	Node& node = nodes[node_id];
+	free_list = node.parent;
+	node = Node();
+	node.height = 0;
+	return node_id;
+}
+
+void AABBTree::free_node(int node_id)
+{
+	nodes[node_id].parent = free_list;
+	nodes[node_id].height = -1;
+	free_list = node_id;
+}
+
+int AABBTree::create_proxy(const AABB& aabb, unsigned int user_data)
+{
+	int proxy_id = allocate_node();
+
+	// Fatten the AABB
+	const vec2 margin = { AABB_MARGIN, AABB_MARGIN };
+	nodes[proxy_id].aabb = { aabb.min - margin, aabb.max + margin };
+	nodes[proxy_id].user_data = user_data;
+
+	insert_leaf(proxy_id);
+	leaf_count++;
+	return proxy_id;
+}
+
+void AABBTree::destroy_proxy(int proxy_id)
+{
+	assert(nodes[proxy_id].is_leaf() && nodes[proxy_id].height == 0);
+	remove_leaf(proxy_id);
+	free_node(proxy_id);
+	leaf_count--;
+}
+
+bool AABBTree::move_proxy(int proxy_id, const AABB& aabb, vec2 displacement)
+{
+	assert(nodes[proxy_id].is_leaf() && nodes[proxy_id].height == 0);
+
+	// Still inside the fat AABB, nothing to do
+	if (nodes[proxy_id].aabb.contains(aabb))
+		return false;
+
+	remove_leaf(proxy_id);
+
+	// Extend the AABB by the margin and in the direction of movement
+	const vec2 margin = { AABB_MARGIN, AABB_MARGIN };
+	AABB fat = { aabb.min - margin, aabb.max + margin };
+	vec2 d = DISPLACEMENT_MULTIPLIER * displacement;
+	if (d.x < 0.f)
+		fat.min.x += d.x;
+	else
+		fat.max.x += d.x;
+	if (d.y < 0.f)
+		fat.min.y += d.y;
+	else
+		fat.max.y += d.y;
+	nodes[proxy_id].aabb = fat;
+
+	insert_leaf(proxy_id);
+	return true;
+}
+
+void AABBTree::insert_leaf(int leaf)
+{
+	if (root == NULL_NODE)
+	{
+		root = leaf;
+		nodes[root].parent = NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling by descending along the cheapest surface area cost
+	const AABB leaf_aabb = nodes[leaf].aabb;
+	int index = root;
+	while (!nodes[index].is_leaf())
+	{
+		int left = nodes[index].left;
+		int right = nodes[index].right;
+
+		float area = nodes[index].aabb.perimeter();
+		float combined_area = AABB::merge(nodes[index].aabb, leaf_aabb).perimeter();
+
+		// Cost of creating a new parent for this node and the new leaf
+		float cost = 2.f * combined_area;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritance_cost = 2.f * (combined_area - area);
+
+		// Cost of descending into either child
+		auto descend_cost = [&](int child) {
+			float new_area = AABB::merge(leaf_aabb, nodes[child].aabb).perimeter();
+			if (nodes[child].is_leaf())
+				return new_area + inheritance_cost;
+			return (new_area - nodes[child].aabb.perimeter()) + inheritance_cost;
+		};
+		float cost_left = descend_cost(left);
+		float cost_right = descend_cost(right);
+
+		if (cost < cost_left && cost < cost_right)
+			break;
+
+		index = cost_left < cost_right ? left : right;
+	}
+	int sibling = index;
+
+	// Create a new parent
+	int old_parent = nodes[sibling].parent;
+	int new_parent = allocate_node();
+	nodes[new_parent].parent = old_parent;
+	nodes[new_parent].aabb = AABB::merge(leaf_aabb, nodes[sibling].aabb);
+	nodes[new_parent].height = nodes[sibling].height + 1;
+	nodes[new_parent].left = sibling;
+	nodes[new_parent].right = leaf;
+	nodes[sibling].parent = new_parent;
+	nodes[leaf].parent = new_parent;
+
+	if (old_parent != NULL_NODE)
+	{
+		if (nodes[old_parent].left == sibling)
+			nodes[old_parent].left = new_parent;
+		else
+			nodes[old_parent].right = new_parent;
+	}
+	else
+	{
+		root = new_parent;
+	}
+
+	// Walk back up the tree fixing heights and AABBs
+	index = nodes[leaf].parent;
+	while (index != NULL_NODE)
+	{
+		index = balance(index);
+
+		int left = nodes[index].left;
+		int right = nodes[index].right;
+		nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+		nodes[index].aabb = AABB::merge(nodes[left].aabb, nodes[right].aabb);
+
+		index = nodes[index].parent;
+	}
+}
+
+void AABBTree::remove_leaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grand_parent = nodes[parent].parent;
+	int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+	if (grand_parent == NULL_NODE)
+	{
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		free_node(parent);
+		return;
+	}
+
+	// Destroy the parent and connect the sibling to the grand parent
+	if (nodes[grand_parent].left == parent)
+		nodes[grand_parent].left = sibling;
+	else
+		nodes[grand_parent].right = sibling;
+	nodes[sibling].parent = grand_parent;
+	free_node(parent);
+
+	// Adjust ancestor bounds
+	int index = grand_parent;
+	while (index != NULL_NODE)
+	{
+		index = balance(index);
+
+		int left = nodes[index].left;
+		int right = nodes[index].right;
+		nodes[index].aabb = AABB::merge(nodes[left].aabb, nodes[right].aabb);
+		nodes[index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+
+		index = nodes[index].parent;
+	}
+}
+
+// Performs a left or right rotation if node A is imbalanced, returns the new root of the sub-tree
+int AABBTree::balance(int a_id)
+{
+	Node& a = nodes[a_id];
+	if (a.is_leaf() || a.height < 2)
+		return a_id;
+
+	int b_id = a.left;
+	int c_id = a.right;
+	int balance_factor = nodes[c_id].height - nodes[b_id].height;
+
+	// Rotate C up (right child is too high) or B up (left child is too high).
+	// Both cases are the same with the roles of left and right swapped.
+	if (balance_factor > 1 || balance_factor < -1)
+	{
+		bool rotate_right_up = balance_factor > 1;
+		int up_id = rotate_right_up ? c_id : b_id;
+		int stay_id = rotate_right_up ? b_id : c_id;
+		Node& up = nodes[up_id];
+		int f_id = up.left;
+		int g_id = up.right;
+
+		// Swap A and the rising child
+		up.left = a_id;
+		up.parent = a.parent;
+		a.parent = up_id;
+
+		// A's old parent should point to the rising child
+		if (up.parent != NULL_NODE)
+		{
+			if (nodes[up.parent].left == a_id)
+				nodes[up.parent].left = up_id;
+			else
+				nodes[up.parent].right = up_id;
+		}
+		else
+		{
+			root = up_id;
+		}
+
+		// Keep the higher grand child below the rising node, hand the other one to A
+		int keep_id = nodes[f_id].height > nodes[g_id].height ? f_id : g_id;
+		int give_id = keep_id == f_id ? g_id : f_id;
+		up.right = keep_id;
+		if (rotate_right_up)
+			a.right = give_id;
+		else
+			a.left = give_id;
+		nodes[give_id].parent = a_id;
+
+		a.aabb = AABB::merge(nodes[stay_id].aabb, nodes[give_id].aabb);
+		up.aabb = AABB::merge(a.aabb, nodes[keep_id].aabb);
+		a.height = 1 + std::max(nodes[stay_id].height, nodes[give_id].height);
+		up.height = 1 + std::max(a.height, nodes[keep_id].height);
+
+		return up_id;
+	}
+
+	return a_id;
+}
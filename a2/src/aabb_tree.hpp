@@ -0,0 +1,162 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+
+// Axis-aligned bounding box in window (pixel) coordinates
+struct AABB
+{
+	vec2 min = { 0, 0 };
+	vec2 max = { 0, 0 };
+
+	bool overlaps(const AABB& other) const
+	{
+		return min.x <= other.max.x && other.min.x <= max.x
+			&& min.y <= other.max.y && other.min.y <= max.y;
+	}
+	bool contains(const AABB& other) const
+	{
+		return min.x <= other.min.x && min.y <= other.min.y
+			&& other.max.x <= max.x && other.max.y <= max.y;
+	}
+	// In 2D the surface area heuristic (SAH) degenerates to the perimeter
+	float perimeter() const
+	{
+		return 2.f * ((max.x - min.x) + (max.y - min.y));
+	}
+	static AABB merge(const AABB& a, const AABB& b)
+	{
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+};
+
+// Dynamic bounding volume tree, following the b2DynamicTree of Box2D.
+// Leaves store 'fat' AABBs that are enlarged by a margin and by the predicted
+// displacement, such that slowly moving entities rarely need to be re-inserted.
+// Insertion descends the tree greedily by the surface area heuristic and the tree
+// is kept balanced with AVL rotations.
+class AABBTree
+{
+public:
+	static const int NULL_NODE = -1;
+
+	// Padding added around every leaf AABB, in pixels
+	static constexpr float AABB_MARGIN = 8.f;
+	// How far ahead the displacement is extrapolated when a leaf is re-inserted
+	static constexpr float DISPLACEMENT_MULTIPLIER = 4.f;
+
+	AABBTree();
+
+	// Creates a leaf for the given tight AABB, returns a proxy id
+	int create_proxy(const AABB& aabb, unsigned int user_data);
+	void destroy_proxy(int proxy_id);
+
+	// Refits the leaf if the tight AABB left its fat AABB.
+	// Returns true if the proxy was re-inserted.
+	bool move_proxy(int proxy_id, const AABB& aabb, vec2 displacement);
+
+	unsigned int get_user_data(int proxy_id) const { return nodes[proxy_id].user_data; }
+	void set_user_data(int proxy_id, unsigned int user_data) { nodes[proxy_id].user_data = user_data; }
+	const AABB& get_fat_aabb(int proxy_id) const { return nodes[proxy_id].aabb; }
+
+	// Calls callback(proxy_id) for every leaf whose fat AABB overlaps aabb.
+	// The query stops early if the callback returns false.
+	template <class Callback>
+	void query(const AABB& aabb, Callback callback) const;
+	// Same, with a caller owned traversal stack, such that several threads can query at once
+	template <class Callback>
+	void query(const AABB& aabb, Callback callback, std::vector<int>& traversal_stack) const;
+
+	// Calls callback(user_data_a, user_data_b) once for every pair of leaves with overlapping fat AABBs
+	template <class Callback>
+	void query_pairs(Callback callback) const;
+
+	int height() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+	size_t proxy_count() const { return leaf_count; }
+	void clear();
+
+private:
+	struct Node
+	{
+		AABB aabb;
+		unsigned int user_data = 0;
+		// parent for allocated nodes, next free node for nodes in the free list
+		int parent = NULL_NODE;
+		int left = NULL_NODE;
+		int right = NULL_NODE;
+		// leaf = 0, free node = -1
+		int height = -1;
+
+		bool is_leaf() const { return left == NULL_NODE; }
+	};
+
+	int allocate_node();
+	void free_node(int node_id);
+	void insert_leaf(int leaf);
+	void remove_leaf(int leaf);
+	int balance(int node_id);
+
+	std::vector<Node> nodes;
+	int root;
+	int free_list;
+	size_t leaf_count;
+
+	// Traversal stack, re-used across queries to not allocate every step
+	mutable std::vector<int> stack;
+};
+
+template <class Callback>
+void AABBTree::query(const AABB& aabb, Callback callback) const
+{
+	query(aabb, callback, stack);
+}
+
+template <class Callback>
+void AABBTree::query(const AABB& aabb, Callback callback, std::vector<int>& stack) const
+{
+	if (root == NULL_NODE)
+		return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int node_id = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes[node_id];
+		if (!node.aabb.overlaps(aabb))
+			continue;
+
+		if (node.is_leaf())
+		{
+			if (!callback(node_id))
+				return;
+		}
+		else
+		{
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+template <class Callback>
+void AABBTree::query_pairs(Callback callback) const
+{
+	// Note, query() re-uses the member stack, so the leaves are visited by a plain scan
+	for (int leaf = 0; leaf < (int)nodes.size(); leaf++)
+	{
+		const Node& node = nodes[leaf];
+		if (node.height != 0)
+			continue;
+		query(node.aabb, [&](int other) {
+			// report every pair only once and don't pair a leaf with itself
+			if (other > leaf)
+				callback(node.user_data, nodes[other].user_data);
+			return true;
+		});
+	}
+}
@@ -0,0 +1,79 @@
+// internal
+#include "ai_lod.hpp"
+#include "spatial_index.hpp"
+
+// stlib
+#include <cfloat>
+
+constexpr float AILod::FULL_RADIUS;
+constexpr float AILod::REDUCED_RADIUS;
+constexpr float AILod::HYSTERESIS;
+
+// Outer radius of each tier but the last
+const float TIER_RADIUS[ai_lod_count - 1] = { AILod::FULL_RADIUS, AILod::REDUCED_RADIUS };
+
+bool AILod::update()
+{
+	// A spawn and a death between two steps keep the count but not the generation
+	const bool reassign = frame % REASSIGN_FRAMES == 0 || registry.aiLevels.generation != assigned_generation;
+	if (reassign)
+		assign_tiers();
+
+	// The reduced agents take turns
+	const std::vector<Entity>& reduced = tiers[(int)AI_LOD_ID::REDUCED];
+	deciding = tiers[(int)AI_LOD_ID::FULL];
+	for (size_t i = frame % REDUCED_FRAMES; i < reduced.size(); i += REDUCED_FRAMES)
+		deciding.push_back(reduced[i]);
+
+	frame++;
+	return reassign;
+}
+
+void AILod::assign_tiers()
+{
+	ComponentContainer<AILevel>& levels = registry.aiLevels;
+
+	// Only the agents within reach of a player are visited, all others are far away
+	for (AILevel& level : levels.components)
+		level.distance = FLT_MAX;
+	for (Entity player : registry.players.entities)
+	{
+		if (!registry.motions.has(player))
+			continue;
+		const vec2 position = registry.motions.get(player).position;
+		spatial_index.query_radius(position, REDUCED_RADIUS + HYSTERESIS, COLLISION_MASK_ALL, nearby);
+		for (Entity entity : nearby)
+		{
+			if (!levels.has(entity))
+				continue;
+			AILevel& level = levels.get(entity);
+			level.distance = std::min(level.distance, length(registry.motions.get(entity).position - position));
+		}
+	}
+
+	for (std::vector<Entity>& tier : tiers)
+		tier.clear();
+	for (uint k = 0; k < levels.components.size(); k++)
+	{
+		AILevel& level = levels.components[k];
+		int tier = (int)level.tier;
+		while (tier < (int)AI_LOD_ID::KINEMATIC && level.distance > TIER_RADIUS[tier] + HYSTERESIS)
+			tier++;
+		while (tier > (int)AI_LOD_ID::FULL && level.distance <= TIER_RADIUS[tier - 1])
+			tier--;
+		level.tier = (AI_LOD_ID)tier;
+		tiers[tier].push_back(levels.entities[k]);
+		if (!level.has_slot)
+		{
+			level.slot = next_slot++;
+			level.has_slot = true;
+		}
+	}
+
+	active = tiers[(int)AI_LOD_ID::FULL];
+	active.insert(active.end(), tiers[(int)AI_LOD_ID::REDUCED].begin(), tiers[(int)AI_LOD_ID::REDUCED].end());
+	active_slots.clear();
+	for (Entity entity : active)
+		active_slots.push_back(levels.get(entity).slot);
+	assigned_generation = levels.generation;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// Levels of detail of the AI by distance to the chicken, such that the cost of the decisions
+// follows the number of agents close enough to matter. The agents (the entities with an
+// AILevel) near a player decide every step, the ones at mid range every REDUCED_FRAMES steps
+// in turns, and the far ones not at all. The tiers are assigned from a radius query of the
+// spatial index every REASSIGN_FRAMES steps, or as soon as an agent comes or goes. An agent only moves
+// to a farther tier once it is HYSTERESIS beyond the radius of its tier, such that agents on
+// a border don't flap between tiers.
+class AILod
+{
+public:
+	static const unsigned int REASSIGN_FRAMES = 15;
+	static const unsigned int REDUCED_FRAMES = 4;
+	// Outer radius of the full and the reduced tier, in pixels
+	static constexpr float FULL_RADIUS = 300.f;
+	static constexpr float REDUCED_RADIUS = 600.f;
+	static constexpr float HYSTERESIS = 60.f;
+
+	// Once per step, returns true if the tiers were re-assigned
+	bool update();
+
+	// The agents to decide this step, all full agents and a share of the reduced ones
+	const std::vector<Entity>& get_deciding() const { return deciding; }
+	// The full and the reduced agents, the same from one assignment to the next
+	const std::vector<Entity>& get_active() const { return active; }
+	// The AILevel slots of the active agents
+	const std::vector<unsigned int>& get_active_slots() const { return active_slots; }
+	const std::vector<Entity>& get_agents(AI_LOD_ID tier) const { return tiers[(int)tier]; }
+
+private:
+	void assign_tiers();
+
+	unsigned int frame = 0;
+	unsigned int assigned_generation = 0; // of registry.aiLevels
+	std::vector<Entity> tiers[ai_lod_count];
+	unsigned int next_slot = 0;
+	std::vector<Entity> active;
+	std::vector<unsigned int> active_slots;
+	std::vector<Entity> deciding;
+	std::vector<Entity> nearby;
+};
@@ -0,0 +1,72 @@
+// internal
+#include "ai_planner.hpp"
+
+AIPlanner::AIPlanner(unsigned int thread_count)
+{
+	// The pool's own thread is the caller's, which never waits for the plans
+	jobs.reset(new JobSystem(thread_count + 1));
+}
+
+AIPlanner::~AIPlanner()
+{
+	// The queued plans are cancelled, the ones running finish while their results can be stored
+	for (auto& ticket : pending)
+		ticket.second.cancelled->store(true);
+	jobs.reset();
+}
+
+AIPlanner::PlanKey AIPlanner::make_key(Entity agent, PLAN_ID kind)
+{
+	return ((PlanKey)(unsigned int)agent << 8) | (PlanKey)kind;
+}
+
+void AIPlanner::post(Entity agent, PLAN_ID kind, PlanJob job)
+{
+	const PlanKey key = make_key(agent, kind);
+	cancel(agent, kind);
+	Ticket ticket = { next_generation++, std::make_shared<std::atomic<bool>>(false) };
+	if (next_generation == 0)
+		next_generation = 1;
+	pending[key] = ticket;
+
+	jobs->submit([this, key, ticket, job] {
+		if (ticket.cancelled->load())
+			return; // replaced or cancelled before it started
+		PlanResult result = job();
+		std::lock_guard<std::mutex> lock(completed_mutex);
+		completed.push_back({ key, ticket.generation, std::move(result) });
+	});
+}
+
+void AIPlanner::cancel(Entity agent, PLAN_ID kind)
+{
+	auto it = pending.find(make_key(agent, kind));
+	if (it == pending.end())
+		return;
+	it->second.cancelled->store(true);
+	pending.erase(it);
+}
+
+bool AIPlanner::is_pending(Entity agent, PLAN_ID kind) const
+{
+	return pending.count(make_key(agent, kind)) > 0;
+}
+
+void AIPlanner::update()
+{
+	{
+		std::lock_guard<std::mutex> lock(completed_mutex);
+		applying.swap(completed);
+	}
+	for (Completed& plan : applying)
+	{
+		// A plan that was replaced or cancelled while it ran is dropped
+		auto it = pending.find(plan.key);
+		if (it == pending.end() || it->second.generation != plan.generation)
+			continue;
+		pending.erase(it);
+		if (plan.result)
+			plan.result();
+	}
+	applying.clear();
+}
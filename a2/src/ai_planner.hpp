@@ -0,0 +1,74 @@
+#pragma once
+
+// stlib
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "job_system.hpp"
+
+enum class PLAN_ID {
+	ESCAPE = 0, // the wall a bug escapes to after meeting the chicken
+	PLAN_COUNT = ESCAPE + 1
+};
+const int plan_count = (int)PLAN_ID::PLAN_COUNT;
+
+// Decisions that are too slow for the frame but fine a step or two late, planned on a worker
+// thread. An agent posts a plan and keeps its current behavior, the result is applied on the
+// main thread in a later update(). Each agent has at most one plan of each kind in flight:
+// posting again replaces the older plan, which is skipped if it didn't start yet and dropped
+// if it finished, and cancel() does the same without a replacement.
+class AIPlanner
+{
+public:
+	// Runs on the main thread once the plan is done, it must check that its entity still exists
+	typedef std::function<void()> PlanResult;
+	// Runs on a worker thread, it must only read what it owns or what nobody writes meanwhile,
+	// such as a snapshot shared with the other plans
+	typedef std::function<PlanResult()> PlanJob;
+
+	// Number of threads planning in the background
+	explicit AIPlanner(unsigned int thread_count = 1);
+	~AIPlanner();
+
+	void post(Entity agent, PLAN_ID kind, PlanJob job);
+	void cancel(Entity agent, PLAN_ID kind);
+	bool is_pending(Entity agent, PLAN_ID kind) const;
+	// Applies the plans finished since the last call, once per step
+	void update();
+
+	size_t get_pending_count() const { return pending.size(); }
+
+private:
+	// The entity and the kind of the plan
+	typedef unsigned long long PlanKey;
+	static PlanKey make_key(Entity agent, PLAN_ID kind);
+
+	struct Ticket
+	{
+		unsigned int generation;
+		std::shared_ptr<std::atomic<bool>> cancelled; // read by the worker before it starts
+	};
+	struct Completed
+	{
+		PlanKey key;
+		unsigned int generation;
+		PlanResult result;
+	};
+
+	std::unordered_map<PlanKey, Ticket> pending; // the newest plan of every key in flight
+	unsigned int next_generation = 1;
+	std::vector<Completed> applying;
+
+	// Written by the workers, read in update()
+	std::mutex completed_mutex;
+	std::vector<Completed> completed;
+
+	// Declared last such that the workers are joined before the rest is destroyed
+	std::unique_ptr<JobSystem> jobs;
+};
@@ -0,0 +1,79 @@
+// internal
+#include "ai_scheduler.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+
+using Clock = std::chrono::high_resolution_clock;
+
+void AIScheduler::set_interval(unsigned int ticks)
+{
+	ticks = std::max(ticks, 1u);
+	if (ticks == interval)
+		return;
+	interval = ticks;
+	// Start over with the first bucket of the new partition
+	bucket = 0;
+	next = 0;
+	fill_buckets();
+}
+
+void AIScheduler::set_agents(const std::vector<Entity>& new_agents, const std::vector<unsigned int>& slots)
+{
+	assert(new_agents.size() == slots.size());
+	agents.clear();
+	for (size_t k = 0; k < new_agents.size(); k++)
+		agents.push_back({ slots[k], new_agents[k] });
+	std::sort(agents.begin(), agents.end(), [](const Agent& a, const Agent& b) { return a.slot < b.slot; });
+	fill_buckets();
+}
+
+void AIScheduler::fill_buckets()
+{
+	// The slot to resume the bucket in progress at
+	const bool resume = bucket < buckets.size() && next < buckets[bucket].size();
+	const unsigned int resume_slot = resume ? buckets[bucket][next].slot : 0;
+
+	buckets.resize(interval);
+	for (std::vector<Agent>& b : buckets)
+		b.clear();
+	for (const Agent& agent : agents)
+		buckets[agent.slot % interval].push_back(agent);
+
+	const std::vector<Agent>& due = buckets[bucket];
+	if (resume)
+		next = std::lower_bound(due.begin(), due.end(), resume_slot,
+			[](const Agent& a, unsigned int slot) { return a.slot < slot; }) - due.begin();
+	else
+		next = std::min(next, due.size());
+}
+
+void AIScheduler::run(const std::function<void(Entity agent)>& update)
+{
+	const auto start = Clock::now();
+	updated_count = 0;
+	over_budget = false;
+	if (buckets.size() != interval)
+		fill_buckets();
+
+	const std::vector<Agent>& due = buckets[bucket];
+	for (; next < due.size(); next++)
+	{
+		if (updated_count > 0)
+		{
+			float elapsed_us = (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+			if (elapsed_us >= budget_us)
+			{
+				// Carried over, the bucket stays due
+				over_budget = true;
+				return;
+			}
+		}
+		update(due[next].entity);
+		updated_count++;
+	}
+
+	bucket = (bucket + 1) % interval;
+	next = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// stlib
+#include <functional>
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+// Spreads the decisions of many agents over ticks of the AI. Every agent comes with a slot, a
+// number it got once when it was registered (see AILevel), and belongs to bucket slot % interval,
+// so its bucket doesn't change when the list of agents is rebuilt and the buckets stay even.
+// Every tick the due bucket is worked through until the time budget is used up. What is left
+// of the bucket is carried over into the next tick before the next bucket is due, so every
+// agent is updated every interval ticks as long as the budget suffices, and the interval
+// stretches evenly when it doesn't. At least one agent is updated per tick.
+class AIScheduler
+{
+public:
+	// Every agent is updated once per interval ticks
+	void set_interval(unsigned int ticks);
+	unsigned int get_interval() const { return interval; }
+	// Time per tick, in microseconds
+	void set_budget_us(float microseconds) { budget_us = microseconds; }
+	float get_budget_us() const { return budget_us; }
+
+	// Replaces the agents, agent k has slot slots[k]. Call it whenever the agents change, a
+	// carried-over bucket resumes at its first agent not updated yet.
+	void set_agents(const std::vector<Entity>& agents, const std::vector<unsigned int>& slots);
+
+	// Calls update(e) for the due agents e
+	void run(const std::function<void(Entity agent)>& update);
+
+	// Agents updated in the last run(), and whether it ran out of time
+	size_t get_updated_count() const { return updated_count; }
+	bool is_over_budget() const { return over_budget; }
+
+private:
+	struct Agent
+	{
+		unsigned int slot;
+		Entity entity;
+	};
+	// Distributes the agents over the buckets, each bucket sorted by slot
+	void fill_buckets();
+
+	unsigned int interval = 1;
+	float budget_us = 500.f;
+	std::vector<Agent> agents; // sorted by slot
+	std::vector<std::vector<Agent>> buckets;
+
+	// The bucket in progress and the position within it
+	unsigned int bucket = 0;
+	size_t next = 0;
+
+	size_t updated_count = 0;
+	bool over_budget = false;
+};
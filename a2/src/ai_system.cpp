@@ -2,11 +2,52 @@
 #include "ai_system.hpp"
 #include "world_init.hpp"
 
+// Influence above which a bug flees, within 90% of the radius of a threat or close to where one just was
+const float THREAT_INFLUENCE = 0.1f;
+
 vec2 bounding_box(const Motion& motion)
 {
 	// abs is to avoid negative scale due to the facing direction.
 	return { abs(motion.scale.x), abs(motion.scale.y) };
 }
+void AISystem::init()
+{
+	// The conditions and actions the behavior trees refer to by name
+	behaviors.add_condition("near_chicken", [this](Entity e) {
+		return chicken_in_sight(registry.motions.get(e).position);
+	});
+	behaviors.add_condition("threatened", [this](Entity e) {
+		return influence_map.get_influence(registry.motions.get(e).position) > THREAT_INFLUENCE;
+	});
+	// Flee down the threat gradient of the chicken and the eagles, harder the closer they are
+	behaviors.add_action("flee_threats", [this](const std::vector<Entity>& agents, std::vector<BT_STATUS_ID>&) {
+		for (Entity e : agents) {
+			const vec2 position = registry.motions.get(e).position;
+			const vec2 gradient = influence_map.get_gradient(position);
+			SteeringAgent& agent = registry.steeringAgents.get(e);
+			// Right at the peak there is no way down, the bug keeps fleeing the way it did
+			if (gradient != vec2(0.f, 0.f))
+				agent.threat = position + normalize(gradient) * InfluenceMap::CELL_SIZE;
+			agent.flee = influence_map.get_influence(position);
+		}
+	});
+	behaviors.add_action("ignore_threats", [](const std::vector<Entity>& agents, std::vector<BT_STATUS_ID>&) {
+		for (Entity e : agents)
+			registry.steeringAgents.get(e).flee = 0.f;
+	});
+	// In range of the chicken the goal path leads to a wall, see update_goal_path()
+	behaviors.add_action("follow_goal_path", [](const std::vector<Entity>& agents, std::vector<BT_STATUS_ID>&) {
+		for (Entity e : agents)
+			registry.steeringAgents.get(e).avoid_walls = 0.f;
+	});
+	behaviors.add_action("avoid_walls", [](const std::vector<Entity>& agents, std::vector<BT_STATUS_ID>&) {
+		for (Entity e : agents)
+			registry.steeringAgents.get(e).avoid_walls = 1.f;
+	});
+
+	bug_behavior = behaviors.load(behaviors_path("bug.bt"));
+}
+
 void AISystem::step(float elapsed_ms)
 {
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -15,7 +56,6 @@ void AISystem::step(float elapsed_ms)
 	// You will likely want to write new functions and need to create
 	// new data structures to implement a more sophisticated Bug AI.
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	(void)elapsed_ms;
 	
     /*Make the bugs smarter by enabling them to avoid the chicken. The bugs should
 	avoid the chicken by staying at least some minimum distance ǫ away from it.After
@@ -25,74 +65,50 @@ void AISystem::step(float elapsed_ms)
 	// Contact chicken = bug moves horizontal toward the goal path (wall) 
 	// hits the wall move in horizontal line towards the other side of the wall 
 	//(void)elapsed_ms; // placeholder to silence unused warning until implemented
-	float current_speed = 1.f;
-	float maxFrame = 2000 * 3;
-	float maxNum = 15;
-	float goal_path = 0; 
-	//float next_frame = 0;
-	//next_frame += -elapsed_ms*current_speed  *0.5;
-	//printf("%d\n", next_frame);
-
-	//float min_distance = 10.0f; 
-	//float goal_path = 0.0; // for now goal path updated every X frames? 
-	float frames = 0.5-elapsed_ms*current_speed; 
-	for (Entity e : registry.eatables.entities) {
-		Motion& m = registry.motions.get(e);
-		vec2 position = registry.motions.get(e).position;
-		//float posStartX = position.x; 
-		vec2 wallDimensionLR = { 30.0f, window_width_px - 30.0f };
 
-		goal_path = getDistancePath(position, wallDimensionLR, goal_path);
-
-		float min_distance = 200.0f; // min distance between bug and CHICKEN0
-		
-		//  within range of collision with the player so we need to recalculate distance
-		if (player_in_range(position, min_distance)) {
-			//printf("it is in range\n");
-			if (frames < 0.f) {
-				//printf("\nframes less than 0");
-				//registry.motions.get(e).position.x += 2.0; // make it 2.0 apart 
-				//registry.motions.get(e).position.y += -2.0;
-				//registry.motions.get(e).velocity.x += -1.0; // keep the zig zag 
-				frames = (maxFrame / 2)*(maxFrame / 2);
-				goal_path = getDistancePath(position, wallDimensionLR, goal_path); // updates goal path every time we are within range of the player 
-				if(registry.motions.get(e).position.x != goal_path) {
-					
-					registry.motions.get(e).position.x += 2.0; // make it 2.0 apart 
-					registry.motions.get(e).position.y += -2.0;
-					registry.motions.get(e).velocity.x += -1.0; // keep the zig zag
-				}
-				
-				//printf("\nframes updated");
-			}
-			
-			//printf("\n end of if statement\n");
-			//registry.motions.get(e).velocity.x *= -1.0;
-			//registry.motions.get(e).position.x += min_distance;
-			//registry.motions.get(e).velocity.x += -1.0;
-
-		} else if (!player_in_range(position, min_distance)) { // not in range, hit wall move opposite direction on normal till dissapear
-			
-			if (m.position.x < 30.0f) {
-				//printf("hello"); left
-				m.position.x += 30.0f; // only horizontal along the new line ater fliping sign
-				m.position.y += 0;
-				//motion.velocity.y *= -10.0;
-				m.velocity.x = m.velocity.x*-1.0;
-				//motion.velocity.y *= -1.0; //hits wall goes down 
-			}
-
-			if (m.position.x > window_width_px - 30.0f) {
-				//printf("bye"); right
-				m.position.x += -30.0f;
-				m.position.y += 0;
-				m.velocity.x = m.velocity.x*-1.0;
-				//motion.velocity.y =10.0; //hits wall goes down 
-			}
+	// The distance fields to the walls and the repulsion around the chicken (min distance
+	// between bug and CHICKEN), shared by all bugs
+	flow_field.update();
+	influence_map.update(elapsed_ms);
+
+	// The escape walls planned since the last step
+	planner.update();
+
+	// Tiers by distance to the chicken, the far agents keep their motion and only turn at the walls
+	if (lod.update()) {
+		for (Entity e : lod.get_agents(AI_LOD_ID::KINEMATIC)) {
+			if (!registry.steeringAgents.has(e))
+				continue;
+			SteeringAgent& agent = registry.steeringAgents.get(e);
+			agent.seek = agent.flee = agent.arrive = agent.wander = 0.f;
+			agent.avoid_walls = 1.f;
 		}
+		// The new bugs get the bug behavior
+		for (Entity e : lod.get_active())
+			if (registry.eatables.has(e) && registry.steeringAgents.has(e) && !registry.behaviorAgents.has(e))
+				registry.behaviorAgents.emplace(e).root = bug_behavior;
+		scheduler.set_agents(lod.get_active(), lod.get_active_slots());
 	}
 
-		
+	// The goal paths are recomputed every X AI steps, a slice of the full and reduced bugs per step
+	scheduler.run([this](Entity e) {
+		if (registry.eatables.has(e) && registry.steeringAgents.has(e))
+			update_goal_path(e);
+	});
+
+	// The bug behavior tree sets the steering weights, see data/behaviors/bug.bt
+	behaviors.tick(lod.get_deciding());
+
+	// The eagles swarm, the boids could be split across threads by ranges of the flock
+	const float step_seconds = elapsed_ms / 1000.f;
+	flock.build();
+	flock.steer(step_seconds);
+	flock.scatter();
+
+	// Blends the steering forces of all agents into their velocities in one pass
+	steering.gather(step_seconds);
+	steer_agents(steering, step_seconds);
+	steering.scatter();
 }
 	//float random = float(rand()) / float((RAND_MAX));
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -100,56 +116,56 @@ void AISystem::step(float elapsed_ms)
 	// DON'T WORRY ABOUT THIS UNTIL ASSIGNMENT 2
 	// You will want to use the createLine from world_init.hpp
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	// check if player is within range of bug
-bool AISystem::player_in_range(vec2 position, float radius) {
-
-	for (Entity e : registry.players.entities) {
-		Motion& motion = registry.motions.get(e);
-		float playerX = motion.position.x;
-		float playerY = motion.position.y;
-		float posX = position.x;
-		float posY = position.y;
-
-		//printf("%lf posX: ", posX);
-		//printf("%lf playerX: ", playerX);
-		
-		double absX = abs(posX - playerX);
-		double absY = abs(posY - playerY);
-		double r = (double)radius; 
-
-		//printf("%d absX: ", absX);
-		//printf("%d absY: ", absY);
 
-		double squareX = absX * absX;
-		double squareY = absY * absY;
-
-		double total = squareX + squareY; 
-
-		if (absY > r || absX > r) {
-			return false;
-		}
-		if (total <= r * r) {
-			return true; 
-		}
-		return false; 
-		
+// Points the bug along the shared fields while it is close to the chicken
+void AISystem::update_goal_path(Entity e) {
+	Motion& m = registry.motions.get(e);
+	SteeringAgent& agent = registry.steeringAgents.get(e);
+	//  within range of collision with the player so we need to recalculate the path
+	if (chicken_in_sight(m.position)) {
+		// the shortest path to a wall that keeps away from the chicken, sampled from the shared fields.
+		// The wall itself is re-planned in the background, the nearest one until the first plan arrives
+		post_escape_plan(e, m.position);
+		WALL_ID goal_wall = flow_field.get_nearest_wall(m.position);
+		if (registry.escapeRoutes.has(e) && registry.escapeRoutes.get(e).wall != WALL_ID::WALL_COUNT)
+			goal_wall = registry.escapeRoutes.get(e).wall;
+		agent.target = m.position + flow_field.get_direction(goal_wall, m.position) * FlowField::REPULSION_RADIUS;
+		agent.seek = 1.f;
+	}
+	else {
+		agent.seek = 0.f;
+		// The next encounter plans anew
+		planner.cancel(e, PLAN_ID::ESCAPE);
+		if (registry.escapeRoutes.has(e))
+			registry.escapeRoutes.remove(e);
 	}
-	return false;
 }
 
-float  AISystem::getDistancePath(vec2 position, vec2 wall_position, float curr_goal_path) {
-
-	float pathRight = abs(position.x - wall_position.x);
-	float pathLeft = abs(position.x - wall_position.y);
-
-	// posX greater value than curr goal path , then return currgoal path
-	if (pathRight < abs(curr_goal_path) && pathRight< pathLeft) {
-		return pathRight;
-	}
-	else if (pathLeft < abs(curr_goal_path) && pathLeft < pathRight) {
-		return pathLeft;
+bool AISystem::chicken_in_sight(vec2 position) {
+	if (flow_field.get_repulsion(position) <= 0.f)
+		return false;
+	for (Entity player : registry.players.entities) {
+		if (registry.motions.has(player)
+			&& !spatial_index.raycast(make_segment(position, registry.motions.get(player).position), COLLISION_LAYER_STATIC, sight_hits))
+			return true;
 	}
-	// or else we return current path as it is the shortest 
-	return curr_goal_path; 
+	return false;
 }
 
+void AISystem::post_escape_plan(Entity e, vec2 position) {
+	// Shares the fields, no cells are copied here
+	const FlowFieldSnapshot field = flow_field.get_snapshot();
+	// Replaces the plan of this bug still in flight, it started from an older position
+	planner.post(e, PLAN_ID::ESCAPE, [field, e, position]() -> AIPlanner::PlanResult {
+		const float left = field.get_escape_cost(WALL_ID::LEFT, position);
+		const float right = field.get_escape_cost(WALL_ID::RIGHT, position);
+		const WALL_ID wall = left <= right ? WALL_ID::LEFT : WALL_ID::RIGHT;
+		return [e, wall]() {
+			if (!registry.steeringAgents.has(e))
+				return; // eaten meanwhile
+			if (!registry.escapeRoutes.has(e))
+				registry.escapeRoutes.emplace(e);
+			registry.escapeRoutes.get(e).wall = wall;
+		};
+	});
+}
@@ -4,6 +4,15 @@
 
 #include "tiny_ecs_registry.hpp"
 #include "common.hpp"
+#include "flow_field.hpp"
+#include "ai_scheduler.hpp"
+#include "steering.hpp"
+#include "influence_map.hpp"
+#include "behavior_tree.hpp"
+#include "ai_lod.hpp"
+#include "flocking.hpp"
+#include "ai_planner.hpp"
+#include "spatial_index.hpp"
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // DON'T WORRY ABOUT THIS CLASS UNTIL ASSIGNMENT 3
@@ -12,7 +21,37 @@
 class AISystem
 {
 public:
+	// Loads the behavior trees
+	void init();
 	void step(float elapsed_ms);
-	bool player_in_range(vec2 x, float y); // checks if player is in range
-	float getDistancePath(vec2 position, vec2 wall_position, float curr_goal_path); // get Distance for shortest path
+
+	// The goal paths are recomputed every `ticks` AI steps, within the budget
+	void set_update_interval(unsigned int ticks) { scheduler.set_interval(ticks); }
+	void set_budget_us(float microseconds) { scheduler.set_budget_us(microseconds); }
+
+private:
+	void update_goal_path(Entity e);
+	// In range of the chicken and not hidden from it behind a static body
+	bool chicken_in_sight(vec2 position);
+	// Plans the escape wall of the bug in the background, see EscapeRoute
+	void post_escape_plan(Entity e, vec2 position);
+
+	// Shared navigation fields the bugs sample instead of searching paths
+	FlowField flow_field;
+	// Where the chicken and the eagles are or just were, read by the bugs in O(1)
+	InfluenceMap influence_map;
+	// Spreads the goal path updates over AI steps
+	AIScheduler scheduler;
+	// How often each agent decides, by distance to the chicken
+	AILod lod;
+	// The bug decisions, data driven from data/behaviors
+	BehaviorTrees behaviors;
+	int bug_behavior = -1;
+	// The eagles
+	Flock flock;
+	// The steering agents packed for the vectorized forces
+	SteeringStreams steering;
+	// Slow decisions, planned off the frame on snapshots of the flow field
+	AIPlanner planner;
+	std::vector<RayHit> sight_hits;
 };
\ No newline at end of file
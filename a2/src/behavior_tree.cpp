@@ -0,0 +1,252 @@
+// internal
+#include "behavior_tree.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <fstream>
+#include <sstream>
+
+// The child of a composite is stored as a byte offset from its first child
+const int MAX_TREE_NODES = 256;
+
+void BehaviorTrees::add_condition(const std::string& name, BehaviorCondition condition)
+{
+	condition_ids[name] = (int)conditions.size();
+	conditions.push_back(condition);
+}
+
+void BehaviorTrees::add_action(const std::string& name, BehaviorAction action)
+{
+	action_ids[name] = (int)actions.size();
+	actions.push_back(action);
+}
+
+int BehaviorTrees::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		printf("Could not open the behavior tree %s\n", path.c_str());
+		return -1;
+	}
+	std::stringstream source;
+	source << file.rdbuf();
+	return compile(source.str());
+}
+
+int BehaviorTrees::compile(const std::string& source)
+{
+	const int root = (int)nodes.size();
+	int composites = 0;
+	int line_number = 0;
+	auto fail = [&](const std::string& message) {
+		printf("Behavior tree line %d: %s\n", line_number, message.c_str());
+		nodes.resize(root);
+		return -1;
+	};
+
+	// (indentation, node) of the nodes that following lines may be nested in
+	std::vector<std::pair<size_t, int>> open;
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		line_number++;
+		line = line.substr(0, line.find('#'));
+		const size_t indentation = line.find_first_not_of(" \t\r");
+		if (indentation == std::string::npos)
+			continue; // blank or comment
+		std::istringstream words(line.substr(indentation));
+		std::string keyword, name;
+		words >> keyword >> name;
+
+		while (!open.empty() && open.back().first >= indentation)
+		{
+			nodes[open.back().second].end = (int)nodes.size();
+			open.pop_back();
+		}
+		if (open.empty() && (int)nodes.size() > root)
+			return fail("a tree has a single root");
+
+		Node node = { BT_NODE_ID::NODE_COUNT, open.empty() ? -1 : open.back().second, (int)nodes.size() + 1, 0 };
+		if (node.parent >= 0)
+		{
+			const Node& parent = nodes[node.parent];
+			if (parent.type == BT_NODE_ID::CONDITION || parent.type == BT_NODE_ID::ACTION)
+				return fail("conditions and actions have no children");
+			if (parent.type == BT_NODE_ID::INVERTER && (int)nodes.size() > node.parent + 1)
+				return fail("an inverter has a single child");
+		}
+
+		if (keyword == "sequence" || keyword == "selector")
+		{
+			node.type = keyword == "sequence" ? BT_NODE_ID::SEQUENCE : BT_NODE_ID::SELECTOR;
+			node.index = composites++;
+		}
+		else if (keyword == "inverter")
+			node.type = BT_NODE_ID::INVERTER;
+		else if (keyword == "condition")
+		{
+			if (condition_ids.count(name) == 0)
+				return fail("unknown condition '" + name + "'");
+			node.type = BT_NODE_ID::CONDITION;
+			node.index = condition_ids[name];
+		}
+		else if (keyword == "action")
+		{
+			if (action_ids.count(name) == 0)
+				return fail("unknown action '" + name + "'");
+			node.type = BT_NODE_ID::ACTION;
+			node.index = action_ids[name];
+		}
+		else
+			return fail("unknown node '" + keyword + "'");
+
+		open.push_back({ indentation, (int)nodes.size() });
+		nodes.push_back(node);
+	}
+	for (; !open.empty(); open.pop_back())
+		nodes[open.back().second].end = (int)nodes.size();
+
+	if ((int)nodes.size() == root)
+		return fail("the tree is empty");
+	if ((int)nodes.size() - root > MAX_TREE_NODES)
+		return fail("the tree has more than " + std::to_string(MAX_TREE_NODES) + " nodes");
+	if (composites > BehaviorAgent::MAX_COMPOSITES)
+		return fail("the tree has more than " + std::to_string(BehaviorAgent::MAX_COMPOSITES) + " sequences and selectors");
+	for (int n = root; n < (int)nodes.size(); n++)
+		if (nodes[n].type <= BT_NODE_ID::INVERTER && nodes[n].end == n + 1)
+			return fail("a sequence, selector, or inverter has no children");
+	return root;
+}
+
+bool BehaviorTrees::advance(Entity entity, BehaviorAgent& agent)
+{
+	// Down from the root, or up from the action that finished
+	bool down = agent.running < 0;
+	int node = down ? agent.root : agent.running;
+	BT_STATUS_ID status = agent.status;
+	while (true)
+	{
+		if (down)
+		{
+			const Node& n = nodes[node];
+			if (n.type == BT_NODE_ID::SEQUENCE || n.type == BT_NODE_ID::SELECTOR)
+			{
+				node += 1 + agent.child[n.index];
+				continue;
+			}
+			if (n.type == BT_NODE_ID::INVERTER)
+			{
+				node += 1;
+				continue;
+			}
+			if (n.type == BT_NODE_ID::ACTION)
+			{
+				agent.running = node;
+				agent.status = BT_STATUS_ID::RUNNING;
+				return true;
+			}
+			status = conditions[n.index](entity) ? BT_STATUS_ID::SUCCESS : BT_STATUS_ID::FAILURE;
+			down = false;
+		}
+
+		// The node finished with status
+		if (node == agent.root)
+		{
+			agent.running = -1;
+			return false;
+		}
+		const int parent = nodes[node].parent;
+		const Node& p = nodes[parent];
+		const bool has_next = nodes[node].end < p.end;
+		if (has_next && ((p.type == BT_NODE_ID::SEQUENCE && status == BT_STATUS_ID::SUCCESS)
+			|| (p.type == BT_NODE_ID::SELECTOR && status == BT_STATUS_ID::FAILURE)))
+		{
+			agent.child[p.index] = (unsigned char)(nodes[node].end - parent - 1);
+			node = nodes[node].end;
+			down = true;
+			continue;
+		}
+		if (p.type == BT_NODE_ID::INVERTER)
+			status = status == BT_STATUS_ID::SUCCESS ? BT_STATUS_ID::FAILURE : BT_STATUS_ID::SUCCESS;
+		else
+			agent.child[p.index] = 0;
+		node = parent;
+	}
+}
+
+void BehaviorTrees::run_actions(const std::vector<unsigned int>& agents_selected)
+{
+	ComponentContainer<BehaviorAgent>& agents = registry.behaviorAgents;
+
+	// Counting sort by action node, such that each action runs once for all of its agents
+	counts.assign(nodes.size() + 1, 0);
+	for (unsigned int k : agents_selected)
+		counts[agents.components[k].running + 1]++;
+	for (size_t n = 1; n < counts.size(); n++)
+		counts[n] += counts[n - 1];
+	order.resize(agents_selected.size());
+	for (unsigned int k : agents_selected)
+		order[counts[agents.components[k].running]++] = k;
+
+	for (size_t begin = 0; begin < order.size();)
+	{
+		const int node = agents.components[order[begin]].running;
+		size_t end = begin;
+		batch.clear();
+		for (; end < order.size() && agents.components[order[end]].running == node; end++)
+			batch.push_back(agents.entities[order[end]]);
+		batch_statuses.assign(batch.size(), BT_STATUS_ID::SUCCESS);
+		actions[nodes[node].index](batch, batch_statuses);
+		for (size_t i = 0; i < batch.size(); i++)
+			agents.components[order[begin + i]].status = batch_statuses[i];
+		begin = end;
+	}
+}
+
+void BehaviorTrees::start(unsigned int k)
+{
+	ComponentContainer<BehaviorAgent>& agents = registry.behaviorAgents;
+	BehaviorAgent& agent = agents.components[k];
+	if (agent.root < 0)
+		return;
+	// The running actions continue, the other agents start over at their root
+	if ((agent.running >= 0 && agent.status == BT_STATUS_ID::RUNNING) || advance(agents.entities[k], agent))
+		selected.push_back(k);
+}
+
+void BehaviorTrees::tick()
+{
+	selected.clear();
+	for (unsigned int k = 0; k < registry.behaviorAgents.components.size(); k++)
+		start(k);
+	run_rounds();
+}
+
+void BehaviorTrees::tick(const std::vector<Entity>& due)
+{
+	ComponentContainer<BehaviorAgent>& agents = registry.behaviorAgents;
+	selected.clear();
+	for (Entity entity : due)
+		if (agents.has(entity))
+			start((unsigned int)(&agents.get(entity) - agents.components.data()));
+	run_rounds();
+}
+
+void BehaviorTrees::run_rounds()
+{
+	ComponentContainer<BehaviorAgent>& agents = registry.behaviorAgents;
+	while (!selected.empty())
+	{
+		run_actions(selected);
+		next_selected.clear();
+		for (unsigned int k : selected)
+		{
+			BehaviorAgent& agent = agents.components[k];
+			if (agent.status != BT_STATUS_ID::RUNNING && advance(agents.entities[k], agent))
+				next_selected.push_back(k);
+		}
+		selected.swap(next_selected);
+	}
+}
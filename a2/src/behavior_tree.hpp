@@ -0,0 +1,92 @@
+#pragma once
+
+// stlib
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+enum class BT_NODE_ID {
+	SEQUENCE = 0, // runs its children in order until one fails
+	SELECTOR = SEQUENCE + 1, // runs its children in order until one succeeds
+	INVERTER = SELECTOR + 1, // swaps success and failure of its only child
+	CONDITION = INVERTER + 1, // succeeds or fails at once
+	ACTION = CONDITION + 1, // may keep running over several ticks
+	NODE_COUNT = ACTION + 1
+};
+
+typedef std::function<bool(Entity entity)> BehaviorCondition;
+// Runs an action for a batch of agents at once and sets the status of each of them. It must not
+// create or remove BehaviorAgents.
+typedef std::function<void(const std::vector<Entity>& agents, std::vector<BT_STATUS_ID>& statuses)> BehaviorAction;
+
+// Behavior trees written as text, one node per line, where a line indented deeper than the one
+// before is its child:
+//
+//	selector
+//		sequence
+//			condition threatened
+//			action flee
+//		action wander
+//
+// The trees are compiled into one flat array in depth first order, every node knows its parent
+// and the end of its subtree, so the next sibling of a node is at its end. The agents keep
+// their running action and the current child of every composite in their BehaviorAgent.
+//
+// A tick moves every agent through its tree up to the next action, then runs each action once
+// for all agents waiting on it, and repeats with the agents whose action finished, until every
+// agent either runs an action or got back to its root. An agent passes its tree at most once
+// per tick and starts over at the root in the next.
+class BehaviorTrees
+{
+public:
+	// The names the trees refer to, register them before compiling the trees
+	void add_condition(const std::string& name, BehaviorCondition condition);
+	void add_action(const std::string& name, BehaviorAction action);
+
+	// Returns the root of the tree, -1 if it doesn't compile
+	int compile(const std::string& source);
+	int load(const std::string& path);
+
+	// Ticks all BehaviorAgents of the registry
+	void tick();
+	// Ticks the given agents only, the others keep their place
+	void tick(const std::vector<Entity>& agents);
+
+	size_t get_node_count() const { return nodes.size(); }
+
+private:
+	struct Node
+	{
+		BT_NODE_ID type;
+		int parent; // -1 for a root
+		int end; // one past the last node of the subtree
+		int index; // the state slot of a composite, the condition or action of a leaf
+	};
+
+	// Moves the agent to its next action, returns false if it got back to the root instead
+	bool advance(Entity entity, BehaviorAgent& agent);
+	// Starts the agent at index k of the container into the first round of the tick
+	void start(unsigned int k);
+	// Runs the selected agents round by round, until none has a next action
+	void run_rounds();
+	// Runs the actions of the selected agents, batched by action node
+	void run_actions(const std::vector<unsigned int>& selected);
+
+	std::vector<Node> nodes;
+	std::unordered_map<std::string, int> condition_ids;
+	std::unordered_map<std::string, int> action_ids;
+	std::vector<BehaviorCondition> conditions;
+	std::vector<BehaviorAction> actions;
+
+	// Scratch space of tick()
+	std::vector<unsigned int> selected;
+	std::vector<unsigned int> next_selected;
+	std::vector<unsigned int> counts;
+	std::vector<unsigned int> order;
+	std::vector<Entity> batch;
+	std::vector<BT_STATUS_ID> batch_statuses;
+};
@@ -29,6 +29,7 @@ inline std::string shader_path(const std::string& name) {return std::string(PROJ
 inline std::string textures_path(const std::string& name) {return data_path() + "/textures/" + std::string(name);};
 inline std::string audio_path(const std::string& name) {return data_path() + "/audio/" + std::string(name);};
 inline std::string mesh_path(const std::string& name) {return data_path() + "/meshes/" + std::string(name);};
+inline std::string behaviors_path(const std::string& name) {return data_path() + "/behaviors/" + std::string(name);};
 
 const int window_width_px = 600;
 const int window_height_px = 900;
@@ -23,6 +23,13 @@ struct Eatable
 
 };
 
+// Bodies that never move, like the eggs on the ground. The physics system keeps them in a
+// separate broadphase, skips them in the integration, and only tests them against moving bodies.
+struct StaticBody
+{
+
+};
+
 // All data relevant to the shape and motion of entities
 struct Motion {
 	vec2 position = { 0, 0 };
@@ -34,12 +41,99 @@ struct Motion {
 	bool in_motion = false;
 };
 
-// Stucture to store collision information
-struct Collision
+// Motion at the previous fixed step, the renderer interpolates between it and the Motion.
+// Kept out of Motion so the physics and the AI don't carry it around.
+struct PreviousMotion {
+	vec2 position = { 0, 0 };
+	float angle = 0;
+};
+
+// Steering behaviors the AI blends into the velocity of an entity, the weights scale the
+// force of each behavior and 0 turns it off. The forces are computed for all agents at once,
+// see steering.hpp.
+struct SteeringAgent
+{
+	vec2 target = { 0, 0 }; // seek and arrive
+	vec2 threat = { 0, 0 }; // flee
+	float max_speed = 100;
+	float max_force = 200; // pixels per second squared
+	float seek = 0;
+	float flee = 0;
+	float arrive = 0;
+	float wander = 0;
+	float avoid_walls = 0;
+	float wander_angle = 0;
+};
+
+enum class BT_STATUS_ID {
+	SUCCESS = 0,
+	FAILURE = SUCCESS + 1,
+	RUNNING = FAILURE + 1
+};
+
+// Where an entity is in its behavior tree (see behavior_tree.hpp). The state of the composite
+// nodes is stored inline, such that the state of all agents is contiguous in the container.
+struct BehaviorAgent
+{
+	static const int MAX_COMPOSITES = 16;
+	int root = -1; // of the tree, -1 for none
+	int running = -1; // the action node, -1 to start over at the root
+	BT_STATUS_ID status = BT_STATUS_ID::RUNNING;
+	unsigned char child[MAX_COMPOSITES] = {}; // current child of each composite, 0 is the first
+};
+
+enum class AI_LOD_ID {
+	FULL = 0, // decides every step
+	REDUCED = FULL + 1, // decides every few steps
+	KINEMATIC = REDUCED + 1, // keeps its motion, only turned back at the walls
+	LOD_COUNT = KINEMATIC + 1
+};
+const int ai_lod_count = (int)AI_LOD_ID::LOD_COUNT;
+
+// How much AI an entity gets, assigned by its distance to the chicken (see ai_lod.hpp)
+struct AILevel
+{
+	AI_LOD_ID tier = AI_LOD_ID::FULL;
+	float distance = 0; // to the closest player at the last assignment
+	unsigned int slot = 0; // handed out round robin at the first assignment, see AIScheduler
+	bool has_slot = false;
+};
+
+// An entity that flocks with the others (see flocking.hpp), returning to its cruise velocity
+struct Boid
 {
-	// Note, the first object is stored in the ECS container.entities
-	Entity other; // the second object involved in the collision
-	Collision(Entity& other) { this->other = other; };
+	vec2 cruise = { 0, 100 };
+};
+
+enum class WALL_ID {
+	LEFT = 0,
+	RIGHT = LEFT + 1,
+	WALL_COUNT = RIGHT + 1
+};
+const int wall_count = (int)WALL_ID::WALL_COUNT;
+
+// The wall a bug escapes to after meeting the chicken, planned in the background (see ai_planner.hpp)
+struct EscapeRoute
+{
+	WALL_ID wall = WALL_ID::WALL_COUNT; // none until the first plan arrives
+};
+
+// Collision layers, every entity is on one (or more) layers and its mask lists the layers
+// it wants to collide with. A pair is only tested if one entity's mask contains the
+// other's layer, and a Collision is only reported to the entity whose mask matched.
+const unsigned int COLLISION_LAYER_DEFAULT = 1u << 0;
+const unsigned int COLLISION_LAYER_PLAYER = 1u << 1;
+const unsigned int COLLISION_LAYER_DEADLY = 1u << 2;
+const unsigned int COLLISION_LAYER_EATABLE = 1u << 3;
+const unsigned int COLLISION_LAYER_DEBUG = 1u << 4;
+const unsigned int COLLISION_LAYER_STATIC = 1u << 5; // blocks the line of sight of the AI
+const unsigned int COLLISION_MASK_ALL = ~0u;
+
+// Entities without a CollisionFilter collide with everything
+struct CollisionFilter
+{
+	unsigned int layer = COLLISION_LAYER_DEFAULT;
+	unsigned int mask = COLLISION_MASK_ALL;
 };
 
 // Data structure for toggling debug mode
@@ -81,6 +175,69 @@ struct TexturedVertex
 	vec2 texcoord;
 };
 
+struct MeshCollider;
+
+// Pixel coverage of a sprite or mesh in its normalized space (-0.5 ... 0.5), one bit per block
+// of texels. Row r covers local y in [-0.5 + r / rows, -0.5 + (r + 1) / rows), bit c of a row
+// covers local x in [-0.5 + c / 64, -0.5 + (c + 1) / 64) (texture row 0 is at local y = -0.5).
+// The pair test resamples both masks to a grid of world pixels, cached per world scale since
+// all entities of a kind share their size, and compares them a 64 bit word at a time.
+struct SpriteMask
+{
+	static const int COLUMNS = 64;
+	int rows = 0;
+	std::vector<uint64_t> bits; // one word per row
+
+	// The mask resampled to cells of WORLD_CELL_SIZE pixels, starting at the bounding box minimum
+	struct Scaled
+	{
+		vec2 scale;
+		int columns;
+		int rows;
+		int words; // words per row
+		std::vector<uint64_t> bits; // column major, word w of row r is at w * rows + r
+	};
+	mutable std::vector<Scaled> scaled;
+	mutable size_t next_evicted = 0;
+
+	// A texel is covered if its alpha exceeds the threshold, a block if any of its texels is
+	void build(const unsigned char* rgba, int width, int height, unsigned char alpha_threshold = 127);
+	// A block is covered if any triangle of the collider overlaps it
+	void build(const MeshCollider& collider);
+	bool empty() const { return rows == 0; }
+	// Only for the angles the sprite is drawn upright or upside down at, false otherwise
+	static bool supports(const Motion& motion);
+	// Whether any covered cells overlap, both motions have to be supported
+	bool overlaps(const Motion& motion, const SpriteMask& other, const Motion& other_motion) const;
+
+private:
+	const Scaled& get_scaled(vec2 scale) const;
+};
+
+// Collision geometry of a mesh in its normalized space (-0.5 ... 0.5), precomputed when
+// the mesh is loaded. The convex hull rejects most candidates cheaply, a small bounding
+// volume hierarchy over the triangles answers the exact test.
+struct MeshCollider
+{
+	std::vector<vec2> hull;
+	// Triangle corners, re-ordered such that every BVH leaf covers a contiguous range
+	std::vector<vec2> triangles;
+	struct Node
+	{
+		vec2 min;
+		vec2 max;
+		int first; // first triangle of a leaf, right child of an inner node (the left child is the next node)
+		int count; // number of triangles of a leaf, 0 for inner nodes
+	};
+	std::vector<Node> nodes;
+	SpriteMask mask;
+
+	void build(const std::vector<ColoredVertex>& vertices, const std::vector<uint16_t>& vertex_indices);
+	bool empty() const { return hull.empty(); }
+	// Exact test against a convex quad given in the normalized space of the mesh
+	bool overlaps(const vec2 quad[4]) const;
+};
+
 // Mesh datastructure for storing vertex and index buffers
 struct Mesh
 {
@@ -88,6 +245,7 @@ struct Mesh
 	vec2 original_size = {1,1};
 	std::vector<ColoredVertex> vertices;
 	std::vector<uint16_t> vertex_indices;
+	MeshCollider collider;
 };
 
 // LightUp struct 
@@ -0,0 +1,251 @@
+// internal
+#include "contact_manager.hpp"
+
+ContactManager contact_manager;
+
+const unsigned long long ContactManager::EMPTY_KEY;
+
+// Initial number of slots, a power of two
+const size_t INITIAL_CONTACT_SLOTS = 64;
+
+// 64-bit finalizer of MurmurHash3, the keys are consecutive ids that need mixing
+static size_t hash_key(unsigned long long key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ull;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+ContactManager::ContactManager()
+{
+	slots.resize(INITIAL_CONTACT_SLOTS);
+}
+
+unsigned long long ContactManager::make_key(unsigned int a, unsigned int b)
+{
+	return ((unsigned long long)std::min(a, b) << 32) | std::max(a, b);
+}
+
+size_t ContactManager::find_slot(unsigned long long key) const
+{
+	const size_t mask = slots.size() - 1;
+	size_t slot = hash_key(key) & mask;
+	while (slots[slot].key != EMPTY_KEY && slots[slot].key != key)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+void ContactManager::erase_slot(size_t slot)
+{
+	// Backward shift deletion, moves the following entries of the probe sequence up such that no tombstones are needed
+	const size_t mask = slots.size() - 1;
+	size_t next = (slot + 1) & mask;
+	while (slots[next].key != EMPTY_KEY)
+	{
+		size_t home = hash_key(slots[next].key) & mask;
+		// The entry may move to the hole if its home is not in (slot, next]
+		if (((next - home) & mask) >= ((next - slot) & mask))
+		{
+			slots[slot] = slots[next];
+			slot = next;
+		}
+		next = (next + 1) & mask;
+	}
+	slots[slot] = Slot();
+}
+
+void ContactManager::grow()
+{
+	std::vector<Slot> old_slots;
+	old_slots.swap(slots);
+	slots.resize(old_slots.size() * 2);
+	for (const Slot& slot : old_slots)
+		if (slot.key != EMPTY_KEY)
+			slots[find_slot(slot.key)] = slot;
+}
+
+void ContactManager::emit(CONTACT_EVENT_ID event, unsigned int pair)
+{
+	std::vector<Contact>& events = event == CONTACT_EVENT_ID::BEGIN ? begin_events
+		: event == CONTACT_EVENT_ID::STAY ? stay_events : end_events;
+	const Contact& contact = pairs[pair];
+	if (wants[pair] & 1)
+	{
+		events.push_back({ contact.entity, contact.other });
+		for (unsigned int handler : route_table[routes[2 * pair]].handlers[(int)event])
+			buckets[handler].push_back({ contact.entity, contact.other });
+	}
+	if (wants[pair] & 2)
+	{
+		events.push_back({ contact.other, contact.entity });
+		for (unsigned int handler : route_table[routes[2 * pair + 1]].handlers[(int)event])
+			buckets[handler].push_back({ contact.other, contact.entity });
+	}
+}
+
+unsigned int ContactManager::find_route(unsigned int layer, unsigned int other_layer)
+{
+	const unsigned long long key = ((unsigned long long)layer << 32) | other_layer;
+	auto it = route_ids.find(key);
+	if (it != route_ids.end())
+		return it->second;
+
+	Route route;
+	for (unsigned int h = 0; h < handlers.size(); h++)
+		if ((handlers[h].entity_layers & layer) && (handlers[h].other_layers & other_layer))
+			route.handlers[(int)handlers[h].event].push_back(h);
+	route_table.push_back(route);
+	route_ids[key] = (unsigned int)route_table.size() - 1;
+	return (unsigned int)route_table.size() - 1;
+}
+
+void ContactManager::update_routes(unsigned int pair)
+{
+	routes[2 * pair] = find_route(layers[2 * pair], layers[2 * pair + 1]);
+	routes[2 * pair + 1] = find_route(layers[2 * pair + 1], layers[2 * pair]);
+}
+
+void ContactManager::begin_step()
+{
+	step_count++;
+	begin_events.clear();
+	stay_events.clear();
+	end_events.clear();
+	for (std::vector<Contact>& bucket : buckets)
+		bucket.clear();
+}
+
+void ContactManager::add(Entity entity, Entity other, const CollisionFilter& entity_filter, const CollisionFilter& other_filter)
+{
+	const unsigned int a = entity, b = other;
+	const unsigned long long key = make_key(a, b);
+	const bool swapped = b < a;
+	const CollisionFilter& first = swapped ? other_filter : entity_filter;
+	const CollisionFilter& second = swapped ? entity_filter : other_filter;
+	const unsigned char pair_wants = (unsigned char)((first.mask & second.layer) ? 1 : 0)
+		| (unsigned char)((second.mask & first.layer) ? 2 : 0);
+
+	if (2 * (pairs.size() + 1) > slots.size())
+		grow();
+	Slot& slot = slots[find_slot(key)];
+	if (slot.key == EMPTY_KEY)
+	{
+		slot.key = key;
+		slot.index = (unsigned int)pairs.size();
+		pairs.push_back(swapped ? Contact{ other, entity } : Contact{ entity, other });
+		pair_keys.push_back(key);
+		stamps.push_back(step_count);
+		wants.push_back(pair_wants);
+		layers.push_back(first.layer);
+		layers.push_back(second.layer);
+		routes.resize(routes.size() + 2);
+		update_routes(slot.index);
+		emit(CONTACT_EVENT_ID::BEGIN, slot.index);
+		return;
+	}
+	const unsigned int i = slot.index;
+	stamps[i] = step_count;
+	wants[i] = pair_wants;
+	if (layers[2 * i] != first.layer || layers[2 * i + 1] != second.layer)
+	{
+		layers[2 * i] = first.layer;
+		layers[2 * i + 1] = second.layer;
+		update_routes(i);
+	}
+	emit(CONTACT_EVENT_ID::STAY, i);
+}
+
+void ContactManager::end_step()
+{
+	// Pairs that weren't reported in this step stopped touching
+	ended_keys.clear();
+	for (size_t i = 0; i < pairs.size(); i++)
+		if (stamps[i] != step_count)
+			ended_keys.push_back(pair_keys[i]);
+	// In key order, the dense order depends on the removal history
+	std::sort(ended_keys.begin(), ended_keys.end());
+
+	for (unsigned long long key : ended_keys)
+	{
+		size_t slot = find_slot(key);
+		unsigned int i = slots[slot].index;
+		emit(CONTACT_EVENT_ID::END, i);
+		erase_slot(slot);
+
+		// Move the last pair into the gap
+		unsigned int last = (unsigned int)pairs.size() - 1;
+		if (i != last)
+		{
+			pairs[i] = pairs[last];
+			pair_keys[i] = pair_keys[last];
+			stamps[i] = stamps[last];
+			wants[i] = wants[last];
+			for (int k = 0; k < 2; k++)
+			{
+				layers[2 * i + k] = layers[2 * last + k];
+				routes[2 * i + k] = routes[2 * last + k];
+			}
+			slots[find_slot(pair_keys[i])].index = i;
+		}
+		pairs.pop_back();
+		pair_keys.pop_back();
+		stamps.pop_back();
+		wants.pop_back();
+		layers.resize(layers.size() - 2);
+		routes.resize(routes.size() - 2);
+	}
+}
+
+void ContactManager::add_handler(CONTACT_EVENT_ID event, unsigned int entity_layers, unsigned int other_layers, ContactHandler handler)
+{
+	assert(event != CONTACT_EVENT_ID::CONTACT_EVENT_COUNT);
+	handlers.push_back({ event, entity_layers, other_layers, handler });
+	buckets.resize(handlers.size());
+
+	// The routes of the touching pairs change
+	route_table.clear();
+	route_ids.clear();
+	for (unsigned int i = 0; i < pairs.size(); i++)
+		update_routes(i);
+}
+
+void ContactManager::clear_handlers()
+{
+	handlers.clear();
+	buckets.clear();
+	route_table.clear();
+	route_ids.clear();
+	for (unsigned int i = 0; i < pairs.size(); i++)
+		update_routes(i);
+}
+
+void ContactManager::dispatch()
+{
+	for (size_t h = 0; h < handlers.size(); h++)
+		if (!buckets[h].empty())
+			handlers[h].callback(buckets[h]);
+}
+
+bool ContactManager::is_touching(Entity a, Entity b) const
+{
+	return slots[find_slot(make_key(a, b))].key != EMPTY_KEY;
+}
+
+void ContactManager::clear()
+{
+	slots.assign(INITIAL_CONTACT_SLOTS, Slot());
+	pairs.clear();
+	pair_keys.clear();
+	stamps.clear();
+	wants.clear();
+	layers.clear();
+	routes.clear();
+	for (std::vector<Contact>& bucket : buckets)
+		bucket.clear();
+	begin_events.clear();
+	stay_events.clear();
+	end_events.clear();
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+// stlib
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+
+// A contact as seen by one of the two entities, the one whose collision mask matched the other
+struct Contact
+{
+	Entity entity;
+	Entity other;
+};
+
+enum class CONTACT_EVENT_ID {
+	BEGIN = 0,
+	STAY = BEGIN + 1,
+	END = STAY + 1,
+	CONTACT_EVENT_COUNT = END + 1
+};
+const int contact_event_count = (int)CONTACT_EVENT_ID::CONTACT_EVENT_COUNT;
+
+// Receives all contacts of a step that were routed to it
+typedef std::function<void(const std::vector<Contact>& contacts)> ContactHandler;
+
+// Remembers the touching pairs across steps, keyed by (min, max) entity id in a flat
+// open addressing hash set. The physics system reports every touching pair of a step
+// between begin_step() and end_step(), and the gameplay reads the resulting events:
+// begin for pairs that started touching, stay for pairs that were touching before, and
+// end for pairs that stopped touching (or whose entities were removed).
+// The events of a step are valid until the next begin_step().
+// Gameplay code can also register handlers per event and pair of collision layers, each
+// handler gets a bucket that the events are sorted into as they are emitted. The handlers
+// of a pair are looked up once when it starts touching, and dispatch() hands every handler
+// its bucket without any per contact component checks.
+class ContactManager
+{
+public:
+	ContactManager();
+
+	void begin_step();
+	// The filters tell which of the two asked for the contact and which handlers receive it
+	void add(Entity entity, Entity other, const CollisionFilter& entity_filter, const CollisionFilter& other_filter);
+	void end_step();
+
+	// The handler receives the contacts (entity, other) of the event where entity is on any of
+	// the layers of entity_layers and other on any of other_layers. Handlers run in the order
+	// they were added.
+	void add_handler(CONTACT_EVENT_ID event, unsigned int entity_layers, unsigned int other_layers, ContactHandler handler);
+	void clear_handlers();
+	// Calls the handlers with the events of the last step
+	void dispatch();
+
+	const std::vector<Contact>& get_begin_events() const { return begin_events; }
+	const std::vector<Contact>& get_stay_events() const { return stay_events; }
+	const std::vector<Contact>& get_end_events() const { return end_events; }
+
+	bool is_touching(Entity a, Entity b) const;
+	size_t size() const { return pairs.size(); }
+	void clear();
+
+private:
+	static const unsigned long long EMPTY_KEY = ~0ull;
+
+	// Maps a key to the index of its pair in the dense arrays
+	struct Slot
+	{
+		unsigned long long key = EMPTY_KEY;
+		unsigned int index = 0;
+	};
+
+	static unsigned long long make_key(unsigned int a, unsigned int b);
+	size_t find_slot(unsigned long long key) const; // slot of the key or the empty slot it would go to
+	void erase_slot(size_t slot);
+	void grow();
+	// Appends the contact as seen by the entities that asked for it, to the events and buckets
+	void emit(CONTACT_EVENT_ID event, unsigned int pair);
+	// The route of contacts from an entity on layer to one on other_layer
+	unsigned int find_route(unsigned int layer, unsigned int other_layer);
+	void update_routes(unsigned int pair);
+
+	std::vector<Slot> slots;
+
+	// The touching pairs, densely packed
+	std::vector<Contact> pairs; // entity is the one with the smaller id
+	std::vector<unsigned long long> pair_keys;
+	std::vector<unsigned int> stamps; // last step in which the pair was touching
+	std::vector<unsigned char> wants; // bit 0: the smaller id asked, bit 1: the larger id asked
+	std::vector<unsigned int> layers; // two per pair, of the smaller and the larger id
+	std::vector<unsigned int> routes; // two per pair, from the smaller id to the larger and back
+	unsigned int step_count = 0;
+
+	std::vector<Contact> begin_events;
+	std::vector<Contact> stay_events;
+	std::vector<Contact> end_events;
+	std::vector<unsigned long long> ended_keys;
+
+	struct Handler
+	{
+		CONTACT_EVENT_ID event;
+		unsigned int entity_layers;
+		unsigned int other_layers;
+		ContactHandler callback;
+	};
+	std::vector<Handler> handlers;
+	std::vector<std::vector<Contact>> buckets; // per handler
+
+	// The handlers matching a pair of layers, per event
+	struct Route
+	{
+		std::vector<unsigned int> handlers[contact_event_count];
+	};
+	std::vector<Route> route_table;
+	std::unordered_map<unsigned long long, unsigned int> route_ids; // by (layer, other layer)
+};
+
+// The contacts found by the physics system
+extern ContactManager contact_manager;
@@ -0,0 +1,246 @@
+// internal
+#include "flocking.hpp"
+#include "simd.hpp"
+
+constexpr float Flock::NEIGHBOR_RADIUS;
+
+// Push away from the neighbours, in pixels per second squared, growing from 0 at the radius
+const float SEPARATION_WEIGHT = 300.f;
+// Rate of matching the mean velocity of the neighbours, per second
+const float ALIGNMENT_RATE = 1.f;
+// Pull towards the center of the neighbours, per second squared
+const float COHESION_RATE = 0.5f;
+// Rate of returning to the cruise velocity, per second
+const float CRUISE_RATE = 1.f;
+const float MAX_FLOCK_SPEED = 160.f;
+// Boids spread farther than this many cells share the border cells
+const int MAX_GRID_SIZE = 256;
+
+// The cell of the boid first, then its 8 neighbours
+const int NEIGHBOUR_CELL_X[9] = { 0, -1, 0, 1, -1, 1, -1, 0, 1 };
+const int NEIGHBOUR_CELL_Y[9] = { 0, -1, -1, -1, 0, 0, 1, 1, 1 };
+
+int Flock::cell_x(float position) const
+{
+	return std::min(std::max((int)((position - origin.x) / NEIGHBOR_RADIUS), 0), columns - 1);
+}
+
+int Flock::cell_y(float position) const
+{
+	return std::min(std::max((int)((position - origin.y) / NEIGHBOR_RADIUS), 0), rows - 1);
+}
+
+void Flock::build()
+{
+	ComponentContainer<Boid>& boids = registry.boids;
+	unsorted.clear();
+	unsorted_motions.clear();
+	vec2 min = vec2(INFINITY), max = vec2(-INFINITY);
+	for (uint k = 0; k < boids.components.size(); k++)
+	{
+		if (!registry.motions.has(boids.entities[k]))
+			continue;
+		const Motion& motion = registry.motions.get(boids.entities[k]);
+		unsorted.push_back(k);
+		unsorted_motions.push_back(&motion);
+		min = glm::min(min, motion.position);
+		max = glm::max(max, motion.position);
+	}
+
+	const size_t count = unsorted.size();
+	x.resize(count + SIMD_WIDTH);
+	y.resize(count + SIMD_WIDTH);
+	vx.resize(count + SIMD_WIDTH);
+	vy.resize(count + SIMD_WIDTH);
+	cruise_x.resize(count);
+	cruise_y.resize(count);
+	next_vx.resize(count);
+	next_vy.resize(count);
+	indices.resize(count);
+	if (count == 0)
+	{
+		columns = rows = 0;
+		cell_start.assign(1, 0);
+		return;
+	}
+
+	origin = min;
+	columns = std::min((int)((max.x - min.x) / NEIGHBOR_RADIUS) + 1, MAX_GRID_SIZE);
+	rows = std::min((int)((max.y - min.y) / NEIGHBOR_RADIUS) + 1, MAX_GRID_SIZE);
+
+	// Counting sort by cell
+	cell_start.assign(columns * rows + 1, 0);
+	cells.resize(count);
+	for (size_t n = 0; n < count; n++)
+	{
+		const vec2& position = unsorted_motions[n]->position;
+		cells[n] = cell_y(position.y) * columns + cell_x(position.x);
+		cell_start[cells[n] + 1]++;
+	}
+	for (size_t c = 1; c < cell_start.size(); c++)
+		cell_start[c] += cell_start[c - 1];
+	cursor.assign(cell_start.begin(), cell_start.end() - 1);
+	for (size_t n = 0; n < count; n++)
+	{
+		const unsigned int slot = cursor[cells[n]]++;
+		const Motion& motion = *unsorted_motions[n];
+		const Boid& boid = boids.components[unsorted[n]];
+		x[slot] = motion.position.x;
+		y[slot] = motion.position.y;
+		vx[slot] = motion.velocity.x;
+		vy[slot] = motion.velocity.y;
+		cruise_x[slot] = boid.cruise.x;
+		cruise_y[slot] = boid.cruise.y;
+		indices[slot] = unsorted[n];
+	}
+}
+
+void Flock::scatter()
+{
+	ComponentContainer<Boid>& boids = registry.boids;
+	for (uint k = 0; k < indices.size(); k++)
+		registry.motions.get(boids.entities[indices[k]]).velocity = { next_vx[k], next_vy[k] };
+}
+
+namespace {
+	int bit_count(int bits)
+	{
+		int count = 0;
+		for (; bits != 0; bits &= bits - 1)
+			count++;
+		return count;
+	}
+
+#if SIMD_WIDTH > 1
+	const float LANE_INDEX[8] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+
+	float horizontal_sum(simd_float a)
+	{
+		alignas(32) float lanes[SIMD_WIDTH];
+		simd_store(lanes, a);
+		float sum = 0.f;
+		for (int l = 0; l < SIMD_WIDTH; l++)
+			sum += lanes[l];
+		return sum;
+	}
+#endif
+}
+
+template <bool vectorized>
+void Flock::steer_range(size_t begin, size_t end, float step_seconds)
+{
+	const float radius_sq = NEIGHBOR_RADIUS * NEIGHBOR_RADIUS;
+	const float inverse_radius = 1.f / NEIGHBOR_RADIUS;
+	for (size_t i = begin; i < end; i++)
+	{
+		const float px = x[i], py = y[i];
+		float separation_x = 0.f, separation_y = 0.f;
+		float velocity_x = 0.f, velocity_y = 0.f;
+		float offset_x = 0.f, offset_y = 0.f; // sum of the neighbours relative to the boid
+		int count = 0;
+#if SIMD_WIDTH > 1
+		const simd_float lane_index = simd_load(LANE_INDEX);
+		const simd_float pos_x = simd_set1(px), pos_y = simd_set1(py);
+		const simd_float zero = simd_set1(0.f), radius_sq_lanes = simd_set1(radius_sq), inverse_radius_lanes = simd_set1(inverse_radius);
+		simd_float lanes_separation_x = zero, lanes_separation_y = zero;
+		simd_float lanes_velocity_x = zero, lanes_velocity_y = zero;
+		simd_float lanes_offset_x = zero, lanes_offset_y = zero;
+#endif
+
+		const int cx = cell_x(px), cy = cell_y(py);
+		for (int n = 0; n < 9 && count < MAX_NEIGHBORS; n++)
+		{
+			const int nx = cx + NEIGHBOUR_CELL_X[n], ny = cy + NEIGHBOUR_CELL_Y[n];
+			if (nx < 0 || nx >= columns || ny < 0 || ny >= rows)
+				continue;
+			const unsigned int first = cell_start[ny * columns + nx], last = cell_start[ny * columns + nx + 1];
+			for (unsigned int block = first; block < last && count < MAX_NEIGHBORS; block += BLOCK)
+			{
+				const unsigned int block_end = std::min(block + (unsigned int)BLOCK, last);
+				unsigned int j = block;
+#if SIMD_WIDTH > 1
+				if (vectorized)
+				{
+					// The lanes past the end of the block are masked out
+					const simd_float block_end_lanes = simd_set1((float)block_end);
+					for (; j < block_end; j += SIMD_WIDTH)
+					{
+						const simd_float dx = simd_sub(simd_load(&x[j]), pos_x);
+						const simd_float dy = simd_sub(simd_load(&y[j]), pos_y);
+						const simd_float distance_sq = simd_add(simd_mul(dx, dx), simd_mul(dy, dy));
+						const simd_mask in_block = simd_lt(simd_add(simd_set1((float)j), lane_index), block_end_lanes);
+						const simd_mask within = simd_and(in_block, simd_and(simd_lt(distance_sq, radius_sq_lanes), simd_gt(distance_sq, zero)));
+						const int bits = simd_movemask(within);
+						if (bits == 0)
+							continue;
+						count += bit_count(bits);
+						// (1 / d - 1 / R) * d is 1 right at the boid and 0 at the radius
+						const simd_float weight = simd_sub(simd_div(simd_set1(1.f), simd_sqrt(simd_max(distance_sq, simd_set1(1e-6f)))), inverse_radius_lanes);
+						lanes_separation_x = simd_sub(lanes_separation_x, simd_select(within, simd_mul(dx, weight), zero));
+						lanes_separation_y = simd_sub(lanes_separation_y, simd_select(within, simd_mul(dy, weight), zero));
+						lanes_velocity_x = simd_add(lanes_velocity_x, simd_select(within, simd_load(&vx[j]), zero));
+						lanes_velocity_y = simd_add(lanes_velocity_y, simd_select(within, simd_load(&vy[j]), zero));
+						lanes_offset_x = simd_add(lanes_offset_x, simd_select(within, dx, zero));
+						lanes_offset_y = simd_add(lanes_offset_y, simd_select(within, dy, zero));
+					}
+				}
+#endif
+				for (; j < block_end; j++)
+				{
+					const float dx = x[j] - px, dy = y[j] - py;
+					const float distance_sq = dx * dx + dy * dy;
+					if (!(distance_sq < radius_sq && distance_sq > 0.f))
+						continue;
+					count++;
+					const float weight = 1.f / sqrtf(std::max(distance_sq, 1e-6f)) - inverse_radius;
+					separation_x -= dx * weight;
+					separation_y -= dy * weight;
+					velocity_x += vx[j];
+					velocity_y += vy[j];
+					offset_x += dx;
+					offset_y += dy;
+				}
+			}
+		}
+#if SIMD_WIDTH > 1
+		if (vectorized)
+		{
+			separation_x += horizontal_sum(lanes_separation_x);
+			separation_y += horizontal_sum(lanes_separation_y);
+			velocity_x += horizontal_sum(lanes_velocity_x);
+			velocity_y += horizontal_sum(lanes_velocity_y);
+			offset_x += horizontal_sum(lanes_offset_x);
+			offset_y += horizontal_sum(lanes_offset_y);
+		}
+#endif
+
+		float fx = CRUISE_RATE * (cruise_x[i] - vx[i]);
+		float fy = CRUISE_RATE * (cruise_y[i] - vy[i]);
+		if (count > 0)
+		{
+			const float inverse_count = 1.f / (float)count;
+			fx += SEPARATION_WEIGHT * separation_x + ALIGNMENT_RATE * (velocity_x * inverse_count - vx[i]) + COHESION_RATE * offset_x * inverse_count;
+			fy += SEPARATION_WEIGHT * separation_y + ALIGNMENT_RATE * (velocity_y * inverse_count - vy[i]) + COHESION_RATE * offset_y * inverse_count;
+		}
+		float next_x = vx[i] + fx * step_seconds;
+		float next_y = vy[i] + fy * step_seconds;
+		const float speed = sqrtf(next_x * next_x + next_y * next_y);
+		if (speed > MAX_FLOCK_SPEED)
+		{
+			next_x *= MAX_FLOCK_SPEED / speed;
+			next_y *= MAX_FLOCK_SPEED / speed;
+		}
+		next_vx[i] = next_x;
+		next_vy[i] = next_y;
+	}
+}
+
+void Flock::steer(size_t begin, size_t end, float step_seconds)
+{
+	steer_range<true>(begin, end, step_seconds);
+}
+
+void Flock::steer_scalar(float step_seconds)
+{
+	steer_range<false>(0, size(), step_seconds);
+}
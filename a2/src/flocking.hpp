@@ -0,0 +1,64 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// Boids flocking of the entities with a Boid component (the eagles): separation from close
+// neighbours, alignment with their velocity, and cohesion towards their center, on top of the
+// cruise velocity of each boid. build() sorts the boids by cell of a grid with cells of
+// NEIGHBOR_RADIUS, such that the neighbours of a boid are in 9 contiguous ranges of the sorted
+// arrays, and the ranges are scanned 8 (AVX2) or 4 (SSE2/NEON) candidates at a time. A boid
+// stops looking after MAX_NEIGHBORS neighbours, counted per block of BLOCK candidates such that
+// the neighbours are the same with and without SIMD.
+class Flock
+{
+public:
+	static constexpr float NEIGHBOR_RADIUS = 200.f;
+	static const int MAX_NEIGHBORS = 16;
+	static const int BLOCK = 8;
+
+	// Gathers the boids from the registry into the sorted arrays, once per step
+	void build();
+	// New velocities of the boids [begin, end) of the sorted order. Only reads the sorted
+	// arrays and writes its own range, so the boids can be split across threads.
+	void steer(size_t begin, size_t end, float step_seconds);
+	void steer(float step_seconds) { steer(0, size(), step_seconds); }
+	// Scalar reference, the same neighbours but the sums may round differently
+	void steer_scalar(float step_seconds);
+	// Copies the new velocities back to the motions
+	void scatter();
+
+	size_t size() const { return indices.size(); }
+
+private:
+	template <bool vectorized>
+	void steer_range(size_t begin, size_t end, float step_seconds);
+	int cell_x(float position) const;
+	int cell_y(float position) const;
+
+	// Sorted by cell, the positions and velocities are padded for the SIMD loads past the last boid
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> cruise_x;
+	std::vector<float> cruise_y;
+	std::vector<float> next_vx;
+	std::vector<float> next_vy;
+	std::vector<unsigned int> indices; // into registry.boids
+
+	// The grid over the bounds of the boids
+	vec2 origin = { 0, 0 };
+	int columns = 0;
+	int rows = 0;
+	std::vector<unsigned int> cell_start; // boids of cell c are [cell_start[c], cell_start[c + 1])
+
+	// Scratch space of build()
+	std::vector<unsigned int> unsorted;
+	std::vector<const Motion*> unsorted_motions;
+	std::vector<unsigned int> cells;
+	std::vector<unsigned int> cursor;
+};
@@ -0,0 +1,264 @@
+// internal
+#include "flow_field.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <queue>
+#include <cfloat>
+
+constexpr float FlowField::CELL_SIZE;
+constexpr float FlowField::REPULSION_RADIUS;
+
+// Weight of the repulsion in the cost the bugs descend. Above 2 * REPULSION_RADIUS getting away
+// from the chicken always wins over getting closer to the wall.
+const float REPULSION_WEIGHT = 4.f * FlowField::REPULSION_RADIUS;
+// How much longer a route is taken to be right at the chicken, for get_escape_cost()
+const float ESCAPE_EXPOSURE = 4.f;
+
+// The 8 neighbours of a cell
+const int NEIGHBOUR_X[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+const int NEIGHBOUR_Y[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+namespace {
+	// Distance plus repulsion, what the bugs descend
+	float get_field_cost(const std::vector<float>& distance, const std::vector<float>& repulsion, int cell)
+	{
+		return distance[cell] + REPULSION_WEIGHT * repulsion[cell];
+	}
+}
+
+int FlowField::cell_x(float position) const
+{
+	return std::min(std::max((int)floor(position / CELL_SIZE), 0), columns - 1);
+}
+
+int FlowField::cell_y(float position) const
+{
+	return std::min(std::max((int)floor(position / CELL_SIZE), 0), rows - 1);
+}
+
+void FlowField::update()
+{
+	const int new_columns = (int)ceil(window_width_px / CELL_SIZE);
+	const int new_rows = (int)ceil(window_height_px / CELL_SIZE);
+	if (new_columns != columns || new_rows != rows)
+	{
+		columns = new_columns;
+		rows = new_rows;
+		blocked.assign(columns * rows, 0);
+		repulsion = std::make_shared<std::vector<float>>(columns * rows, 0.f);
+		repulsed_cells.clear();
+		player_cells.clear();
+		version++;
+		update_distances();
+	}
+
+	if (update_blocked())
+	{
+		version++;
+		update_distances();
+	}
+	update_repulsion();
+}
+
+bool FlowField::update_blocked()
+{
+	next_blocked.assign(columns * rows, 0);
+	for (Entity entity : registry.staticBodies.entities)
+	{
+		if (!registry.motions.has(entity))
+			continue;
+		const Motion& motion = registry.motions.get(entity);
+		const vec2 half_size = abs(motion.scale) / 2.f;
+		const int x0 = cell_x(motion.position.x - half_size.x), x1 = cell_x(motion.position.x + half_size.x);
+		const int y0 = cell_y(motion.position.y - half_size.y), y1 = cell_y(motion.position.y + half_size.y);
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++)
+				next_blocked[y * columns + x] = 1;
+	}
+	if (next_blocked == blocked)
+		return false;
+	blocked.swap(next_blocked);
+	return true;
+}
+
+void FlowField::update_distances()
+{
+	// Dijkstra from the cells along each wall, diagonal steps may not cut blocked corners
+	typedef std::pair<float, int> Entry;
+	for (int w = 0; w < wall_count; w++)
+	{
+		distances[w] = std::make_shared<std::vector<float>>(columns * rows, FLT_MAX);
+		std::vector<float>& distance = *distances[w];
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+		const int wall_column = w == (int)WALL_ID::LEFT ? 0 : columns - 1;
+		for (int y = 0; y < rows; y++)
+		{
+			const int cell = y * columns + wall_column;
+			if (blocked[cell])
+				continue;
+			// From the cell center to the wall
+			distance[cell] = w == (int)WALL_ID::LEFT ? 0.5f * CELL_SIZE : window_width_px - (wall_column + 0.5f) * CELL_SIZE;
+			open.push({ distance[cell], cell });
+		}
+
+		while (!open.empty())
+		{
+			const Entry entry = open.top();
+			open.pop();
+			const int cell = entry.second;
+			if (entry.first > distance[cell])
+				continue; // already settled at a shorter distance
+			const int x = cell % columns, y = cell / columns;
+			for (int n = 0; n < 8; n++)
+			{
+				const int nx = x + NEIGHBOUR_X[n], ny = y + NEIGHBOUR_Y[n];
+				if (nx < 0 || nx >= columns || ny < 0 || ny >= rows || is_blocked(nx, ny))
+					continue;
+				const bool diagonal = NEIGHBOUR_X[n] != 0 && NEIGHBOUR_Y[n] != 0;
+				if (diagonal && (is_blocked(nx, y) || is_blocked(x, ny)))
+					continue;
+				const float next = entry.first + (diagonal ? sqrtf(2.f) * CELL_SIZE : CELL_SIZE);
+				const int neighbour = ny * columns + nx;
+				if (next < distance[neighbour])
+				{
+					distance[neighbour] = next;
+					open.push({ next, neighbour });
+				}
+			}
+		}
+	}
+}
+
+void FlowField::update_repulsion()
+{
+	next_player_cells.clear();
+	for (Entity entity : registry.players.entities)
+		if (registry.motions.has(entity))
+		{
+			const vec2& position = registry.motions.get(entity).position;
+			next_player_cells.push_back(cell_y(position.y) * columns + cell_x(position.x));
+		}
+	if (next_player_cells == player_cells)
+		return;
+	player_cells.swap(next_player_cells);
+
+	// A snapshot in a planning job may still read the old field
+	if (repulsion.use_count() > 1)
+		repulsion = std::make_shared<std::vector<float>>(*repulsion);
+
+	// Only the cells around the old and the new positions are touched
+	for (int cell : repulsed_cells)
+		(*repulsion)[cell] = 0.f;
+	repulsed_cells.clear();
+	const int reach = (int)ceil(REPULSION_RADIUS / CELL_SIZE);
+	for (int player_cell : player_cells)
+	{
+		const int px = player_cell % columns, py = player_cell / columns;
+		for (int y = std::max(py - reach, 0); y <= std::min(py + reach, rows - 1); y++)
+		{
+			for (int x = std::max(px - reach, 0); x <= std::min(px + reach, columns - 1); x++)
+			{
+				const float distance = CELL_SIZE * sqrtf((float)((x - px) * (x - px) + (y - py) * (y - py)));
+				if (distance >= REPULSION_RADIUS)
+					continue;
+				float& value = (*repulsion)[y * columns + x];
+				if (value == 0.f)
+					repulsed_cells.push_back(y * columns + x);
+				value = std::max(value, 1.f - distance / REPULSION_RADIUS);
+			}
+		}
+	}
+}
+
+float FlowField::get_distance(WALL_ID wall, vec2 position) const
+{
+	return (*distances[(int)wall])[cell_y(position.y) * columns + cell_x(position.x)];
+}
+
+WALL_ID FlowField::get_nearest_wall(vec2 position) const
+{
+	return get_distance(WALL_ID::LEFT, position) <= get_distance(WALL_ID::RIGHT, position) ? WALL_ID::LEFT : WALL_ID::RIGHT;
+}
+
+float FlowField::get_repulsion(vec2 position) const
+{
+	return (*repulsion)[cell_y(position.y) * columns + cell_x(position.x)];
+}
+
+float FlowField::get_cost(WALL_ID wall, int cell) const
+{
+	return get_field_cost(*distances[(int)wall], *repulsion, cell);
+}
+
+vec2 FlowField::get_direction(WALL_ID wall, vec2 position) const
+{
+	const int x = cell_x(position.x), y = cell_y(position.y);
+	float best = get_cost(wall, y * columns + x);
+	vec2 direction = { wall == WALL_ID::LEFT ? -1.f : 1.f, 0.f }; // straight to the wall at a minimum
+	for (int n = 0; n < 8; n++)
+	{
+		const int nx = x + NEIGHBOUR_X[n], ny = y + NEIGHBOUR_Y[n];
+		if (nx < 0 || nx >= columns || ny < 0 || ny >= rows || is_blocked(nx, ny))
+			continue;
+		const float cost = get_cost(wall, ny * columns + nx);
+		if (cost < best)
+		{
+			best = cost;
+			direction = normalize(vec2((float)NEIGHBOUR_X[n], (float)NEIGHBOUR_Y[n]));
+		}
+	}
+	return direction;
+}
+
+FlowFieldSnapshot FlowField::get_snapshot() const
+{
+	FlowFieldSnapshot snapshot;
+	snapshot.columns = columns;
+	snapshot.rows = rows;
+	for (int w = 0; w < wall_count; w++)
+		snapshot.distances[w] = distances[w];
+	snapshot.repulsion = repulsion;
+	return snapshot;
+}
+
+float FlowFieldSnapshot::get_escape_cost(WALL_ID wall, vec2 position) const
+{
+	const std::vector<float>& distance = *distances[(int)wall];
+	int x = std::min(std::max((int)floor(position.x / FlowField::CELL_SIZE), 0), columns - 1);
+	int y = std::min(std::max((int)floor(position.y / FlowField::CELL_SIZE), 0), rows - 1);
+	if (distance[y * columns + x] == FLT_MAX)
+		return FLT_MAX; // walled in
+	float cost = 0.f;
+	// Every step lowers the cost, so the walk ends at the wall or before it loops. The blocked
+	// cells are never lower, their distance is FLT_MAX.
+	for (int steps = 0; steps < columns * rows; steps++)
+	{
+		const int cell = y * columns + x;
+		int next = -1;
+		float best = FLT_MAX, best_step = 0.f;
+		for (int n = 0; n < 8; n++)
+		{
+			const int nx = x + NEIGHBOUR_X[n], ny = y + NEIGHBOUR_Y[n];
+			if (nx < 0 || nx >= columns || ny < 0 || ny >= rows)
+				continue;
+			// Straight steps win the ties of the distance field
+			const float step = FlowField::CELL_SIZE * ((NEIGHBOUR_X[n] != 0 && NEIGHBOUR_Y[n] != 0) ? sqrtf(2.f) : 1.f);
+			const float neighbour_cost = get_field_cost(distance, *repulsion, ny * columns + nx) + step;
+			if (next < 0 || neighbour_cost < best + best_step)
+			{
+				best = neighbour_cost - step;
+				best_step = step;
+				next = n;
+			}
+		}
+		if (next < 0 || best >= get_field_cost(distance, *repulsion, cell))
+			break;
+		// A step through the repulsion costs up to ESCAPE_EXPOSURE times its length more
+		cost += best_step * (1.f + ESCAPE_EXPOSURE * (*repulsion)[cell]);
+		x += NEIGHBOUR_X[next];
+		y += NEIGHBOUR_Y[next];
+	}
+	// Stuck short of the wall, the rest is straight
+	return cost + distance[y * columns + x];
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// stlib
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+
+// The distance and repulsion fields of a FlowField at one step, shared read-only with planning
+// jobs on other threads. Taking one copies no cells, the flow field copies on write instead.
+struct FlowFieldSnapshot
+{
+	int columns = 0;
+	int rows = 0;
+	std::shared_ptr<const std::vector<float>> distances[wall_count];
+	std::shared_ptr<const std::vector<float>> repulsion;
+
+	// Length of the route FlowField::get_direction() leads along to the wall, weighted up where it
+	// passes close to the chicken. Walks the route cell by cell, so it is for planning, not per frame.
+	float get_escape_cost(WALL_ID wall, vec2 position) const;
+};
+
+// Coarse navigation fields over the window, shared by all bugs such that a bug only samples
+// its cell instead of searching a path. The distance fields hold the length of the shortest
+// path from every cell to the left and right wall around the cells blocked by static bodies,
+// they are only recomputed when the blocked cells change. The repulsion field rises towards
+// the chicken within REPULSION_RADIUS and is only re-stamped when the chicken enters another cell.
+class FlowField
+{
+public:
+	// Edge length of a cell, in pixels
+	static constexpr float CELL_SIZE = 20.f;
+	// The minimum distance the bugs keep from the chicken
+	static constexpr float REPULSION_RADIUS = 200.f;
+
+	// Updates the fields from the registry
+	void update();
+
+	// Path length to the wall, in pixels
+	float get_distance(WALL_ID wall, vec2 position) const;
+	WALL_ID get_nearest_wall(vec2 position) const;
+	// 1 at the chicken, falling to 0 at REPULSION_RADIUS
+	float get_repulsion(vec2 position) const;
+	// Unit vector towards the wall along the distance field, bent away from the chicken
+	vec2 get_direction(WALL_ID wall, vec2 position) const;
+	FlowFieldSnapshot get_snapshot() const;
+
+	// The occupancy grid, its version changes whenever cells become blocked or free
+	int get_columns() const { return columns; }
+	int get_rows() const { return rows; }
+	int cell_x(float position) const;
+	int cell_y(float position) const;
+	bool is_blocked(int x, int y) const { return blocked[y * columns + x] != 0; }
+	unsigned int get_version() const { return version; }
+
+private:
+	// Returns true if the blocked cells changed
+	bool update_blocked();
+	void update_distances();
+	void update_repulsion();
+	// Distance plus repulsion, what get_direction() descends
+	float get_cost(WALL_ID wall, int cell) const;
+
+	int columns = 0;
+	int rows = 0;
+	unsigned int version = 0;
+	std::vector<unsigned char> blocked;
+	std::vector<unsigned char> next_blocked;
+	// Replaced rather than changed while snapshots may share them
+	std::shared_ptr<std::vector<float>> distances[wall_count];
+
+	std::shared_ptr<std::vector<float>> repulsion;
+	std::vector<int> repulsed_cells; // the non-zero cells of the repulsion field
+	std::vector<int> player_cells; // that the repulsion field was stamped around
+	std::vector<int> next_player_cells;
+};
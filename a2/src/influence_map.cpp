@@ -0,0 +1,180 @@
+// internal
+#include "influence_map.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "simd.hpp"
+
+constexpr float InfluenceMap::CELL_SIZE;
+constexpr float InfluenceMap::MIN_INFLUENCE;
+
+// The influence of a threat falls linearly to 0 at its radius, in pixels
+const float THREAT_RADIUS[threat_count] = { 200.f, 160.f };
+// Fraction of the remembered influence that is left after a second
+const float DECAY_PER_SECOND = 0.2f;
+// Weights of the blur, applied along the rows and then along the columns
+const float BLUR_SIDE = 0.25f;
+const float BLUR_CENTER = 0.5f;
+
+void InfluenceMap::resize()
+{
+	columns = (int)ceil(window_width_px / CELL_SIZE);
+	rows = (int)ceil(window_height_px / CELL_SIZE);
+	presence.assign(columns * rows, 0.f);
+	influence.assign(columns * rows, 0.f);
+	blurred.assign(columns * rows, 0.f);
+	stamps.clear();
+
+	for (int t = 0; t < threat_count; t++)
+	{
+		Kernel& kernel = kernels[t];
+		kernel.reach = (int)ceil(THREAT_RADIUS[t] / CELL_SIZE);
+		const int width = 2 * kernel.reach + 1;
+		kernel.weights.resize(width * width);
+		for (int y = 0; y < width; y++)
+			for (int x = 0; x < width; x++)
+			{
+				const int dx = x - kernel.reach, dy = y - kernel.reach;
+				const float distance = CELL_SIZE * sqrtf((float)(dx * dx + dy * dy));
+				kernel.weights[y * width + x] = std::max(1.f - distance / THREAT_RADIUS[t], 0.f);
+			}
+	}
+}
+
+int InfluenceMap::get_cell(vec2 position) const
+{
+	const int x = std::min(std::max((int)floor(position.x / CELL_SIZE), 0), columns - 1);
+	const int y = std::min(std::max((int)floor(position.y / CELL_SIZE), 0), rows - 1);
+	return y * columns + x;
+}
+
+void InfluenceMap::stamp(int cell, THREAT_ID threat, float sign)
+{
+	const Kernel& kernel = kernels[(int)threat];
+	const int cx = cell % columns, cy = cell / columns;
+	const int width = 2 * kernel.reach + 1;
+	const int x0 = std::max(cx - kernel.reach, 0), x1 = std::min(cx + kernel.reach, columns - 1);
+	for (int y = std::max(cy - kernel.reach, 0); y <= std::min(cy + kernel.reach, rows - 1); y++)
+	{
+		const float* weights = &kernel.weights[(y - cy + kernel.reach) * width];
+		float* row = &presence[y * columns];
+		for (int x = x0; x <= x1; x++)
+			row[x] += sign * weights[x - cx + kernel.reach];
+	}
+}
+
+void InfluenceMap::update_stamp(Entity entity, THREAT_ID threat)
+{
+	if (!registry.motions.has(entity))
+		return;
+	const int cell = get_cell(registry.motions.get(entity).position);
+	auto found = stamps.find(entity);
+	if (found == stamps.end())
+	{
+		stamp(cell, threat, 1.f);
+		stamps[entity] = { cell, threat, true };
+		return;
+	}
+	Stamp& old = found->second;
+	old.seen = true;
+	if (old.cell == cell)
+		return;
+	stamp(old.cell, threat, -1.f);
+	stamp(cell, threat, 1.f);
+	old.cell = cell;
+}
+
+void InfluenceMap::update(float elapsed_ms)
+{
+	if (columns == 0)
+		resize();
+
+	for (auto& entry : stamps)
+		entry.second.seen = false;
+	for (Entity entity : registry.players.entities)
+		update_stamp(entity, THREAT_ID::CHICKEN);
+	for (Entity entity : registry.deadlys.entities)
+		update_stamp(entity, THREAT_ID::EAGLE);
+
+	// Un-stamp the threats that are gone
+	for (auto it = stamps.begin(); it != stamps.end();)
+	{
+		if (it->second.seen)
+		{
+			++it;
+			continue;
+		}
+		stamp(it->second.cell, it->second.threat, -1.f);
+		it = stamps.erase(it);
+	}
+	// Drops the rounding left over from adding and removing the same kernels
+	if (stamps.empty())
+		std::fill(presence.begin(), presence.end(), 0.f);
+
+	decay(elapsed_ms);
+}
+
+void InfluenceMap::decay(float elapsed_ms)
+{
+	const float factor = pow(DECAY_PER_SECOND, elapsed_ms / 1000.f);
+
+	// Along the rows, the cells beyond the border repeat the border cell
+	for (int y = 0; y < rows; y++)
+	{
+		const float* in = &influence[y * columns];
+		float* out = &blurred[y * columns];
+		int x = 1;
+		out[0] = BLUR_SIDE * in[0] + BLUR_CENTER * in[0] + BLUR_SIDE * in[std::min(1, columns - 1)];
+#if SIMD_WIDTH > 1
+		const simd_float side = simd_set1(BLUR_SIDE), center = simd_set1(BLUR_CENTER);
+		for (; x + SIMD_WIDTH < columns; x += SIMD_WIDTH)
+			simd_store(&out[x], simd_add(simd_add(simd_mul(side, simd_load(&in[x - 1])), simd_mul(center, simd_load(&in[x]))),
+				simd_mul(side, simd_load(&in[x + 1]))));
+#endif
+		for (; x < columns; x++)
+			out[x] = BLUR_SIDE * in[x - 1] + BLUR_CENTER * in[x] + BLUR_SIDE * in[std::min(x + 1, columns - 1)];
+	}
+
+	// Along the columns, then decayed and raised to the current presence
+	for (int y = 0; y < rows; y++)
+	{
+		const float* up = &blurred[std::max(y - 1, 0) * columns];
+		const float* mid = &blurred[y * columns];
+		const float* down = &blurred[std::min(y + 1, rows - 1) * columns];
+		const float* current = &presence[y * columns];
+		float* out = &influence[y * columns];
+		int x = 0;
+#if SIMD_WIDTH > 1
+		const simd_float side = simd_set1(BLUR_SIDE), center = simd_set1(BLUR_CENTER), decay = simd_set1(factor);
+		const simd_float min_influence = simd_set1(MIN_INFLUENCE), zero = simd_set1(0.f);
+		for (; x + SIMD_WIDTH <= columns; x += SIMD_WIDTH)
+		{
+			simd_float value = simd_add(simd_add(simd_mul(side, simd_load(&up[x])), simd_mul(center, simd_load(&mid[x]))),
+				simd_mul(side, simd_load(&down[x])));
+			value = simd_max(simd_load(&current[x]), simd_mul(value, decay));
+			simd_store(&out[x], simd_select(simd_lt(value, min_influence), zero, value));
+		}
+#endif
+		for (; x < columns; x++)
+		{
+			const float value = BLUR_SIDE * up[x] + BLUR_CENTER * mid[x] + BLUR_SIDE * down[x];
+			const float remembered = std::max(current[x], value * factor);
+			out[x] = remembered < MIN_INFLUENCE ? 0.f : remembered;
+		}
+	}
+}
+
+float InfluenceMap::get_influence(vec2 position) const
+{
+	return influence[get_cell(position)];
+}
+
+vec2 InfluenceMap::get_gradient(vec2 position) const
+{
+	const int cell = get_cell(position);
+	const int x = cell % columns, y = cell / columns;
+	const int left = std::max(x - 1, 0), right = std::min(x + 1, columns - 1);
+	const int up = std::max(y - 1, 0), down = std::min(y + 1, rows - 1);
+	return {
+		(influence[y * columns + right] - influence[y * columns + left]) / (float)(right - left),
+		(influence[down * columns + x] - influence[up * columns + x]) / (float)(down - up)
+	};
+}
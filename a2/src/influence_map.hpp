@@ -0,0 +1,64 @@
+#pragma once
+
+// stlib
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+
+enum class THREAT_ID {
+	CHICKEN = 0,
+	EAGLE = CHICKEN + 1,
+	THREAT_COUNT = EAGLE + 1
+};
+const int threat_count = (int)THREAT_ID::THREAT_COUNT;
+
+// Coarse grid of how threatened every place is, shared by all agents such that a query is a
+// single lookup. Every threat stamps a falloff kernel into the presence layer, and only the
+// threats that changed cell are un-stamped at the old cell and stamped at the new one. The
+// influence layer remembers where the threats were: each update blurs and decays it, and
+// raises it back to the presence where that is larger.
+class InfluenceMap
+{
+public:
+	// Edge length of a cell, in pixels
+	static constexpr float CELL_SIZE = 20.f;
+	// The remembered influence below this is forgotten, such that the map is flat away from the threats
+	static constexpr float MIN_INFLUENCE = 0.01f;
+
+	// Re-stamps the moved threats from the registry and decays the memory of the old ones
+	void update(float elapsed_ms);
+
+	// 0 far from all threats, 1 at a threat, larger where threats overlap
+	float get_influence(vec2 position) const;
+	// Towards rising influence, per cell, 0 on flat ground
+	vec2 get_gradient(vec2 position) const;
+
+private:
+	struct Kernel
+	{
+		int reach; // in cells
+		std::vector<float> weights; // (2 * reach + 1)^2, row major
+	};
+	struct Stamp
+	{
+		int cell;
+		THREAT_ID threat;
+		bool seen;
+	};
+
+	void resize();
+	void stamp(int cell, THREAT_ID threat, float sign);
+	void update_stamp(Entity entity, THREAT_ID threat);
+	void decay(float elapsed_ms);
+	int get_cell(vec2 position) const;
+
+	int columns = 0;
+	int rows = 0;
+	Kernel kernels[threat_count];
+	std::unordered_map<unsigned int, Stamp> stamps; // by entity
+	std::vector<float> presence;
+	std::vector<float> influence;
+	std::vector<float> blurred;
+};
@@ -0,0 +1,117 @@
+// internal
+#include "job_system.hpp"
+
+JobSystem::JobSystem(unsigned int thread_count)
+{
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int i = 1; i < thread_count; i++)
+		workers.emplace_back(&JobSystem::worker_loop, this);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	task_added.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void JobSystem::worker_loop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			task_added.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty())
+				return; // stopping
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+	}
+}
+
+bool JobSystem::run_one_task()
+{
+	std::function<void()> task;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tasks.empty())
+			return false;
+		task = std::move(tasks.front());
+		tasks.pop_front();
+	}
+	task();
+	return true;
+}
+
+unsigned int JobSystem::chunk_count(size_t count, size_t grain) const
+{
+	assert(grain > 0);
+	// As many grains per chunk as it takes to spread them over the threads, such that no chunk is empty
+	const size_t grains = std::max<size_t>(1, (count + grain - 1) / grain);
+	const size_t grains_per_chunk = (grains + thread_count() - 1) / thread_count();
+	return (unsigned int)((grains + grains_per_chunk - 1) / grains_per_chunk);
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end, unsigned int chunk)>& job)
+{
+	const unsigned int chunks = chunk_count(count, grain);
+	if (chunks == 1)
+	{
+		job(0, count, 0);
+		return;
+	}
+
+	// Equal chunks of whole grains, only the last one may be shorter
+	const size_t grains = (count + grain - 1) / grain;
+	const size_t chunk_size = (grains + thread_count() - 1) / thread_count() * grain;
+
+	unsigned int remaining = chunks - 1;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int c = 1; c < chunks; c++)
+		{
+			size_t begin = c * chunk_size;
+			size_t end = std::min(count, begin + chunk_size);
+			assert(begin < count && begin % grain == 0);
+			tasks.push_back([&job, &remaining, this, begin, end, c] {
+				job(begin, end, c);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					remaining--;
+				}
+				task_done.notify_all();
+			});
+		}
+	}
+	task_added.notify_all();
+
+	// The first chunk runs here, then help with whatever is left in the queue
+	job(0, std::min(count, chunk_size), 0);
+	while (run_one_task())
+		;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	task_done.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+void JobSystem::submit(std::function<void()> task)
+{
+	if (workers.empty())
+	{
+		task();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	task_added.notify_one();
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// stlib
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+// A small pool of worker threads for fork-join parallelism inside the systems, and for
+// background tasks that outlive a frame. The calling thread takes part in the fork-join
+// work, so a pool of n threads starts n - 1 workers and a pool of 1 thread runs everything inline.
+class JobSystem
+{
+public:
+	// thread_count = 0 picks one thread per hardware thread
+	explicit JobSystem(unsigned int thread_count = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int thread_count() const { return (unsigned int)workers.size() + 1; }
+
+	// Splits [0, count) into at most thread_count() contiguous chunks and calls
+	// job(begin, end, chunk) for each of them, returns once all chunks are done.
+	// Chunk boundaries are multiples of grain and chunk indices are in [0, thread_count()),
+	// such that a job can write to per chunk buffers that are merged in chunk order.
+	// Counts of at most one grain run inline on the calling thread.
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end, unsigned int chunk)>& job);
+
+	// Number of chunks parallel_for(count, grain, ...) uses
+	unsigned int chunk_count(size_t count, size_t grain) const;
+
+	// Queues the task for a worker and returns right away, a pool without workers runs it inline.
+	// A parallel_for() on the same pool helps with queued tasks before it returns.
+	void submit(std::function<void()> task);
+
+private:
+	void worker_loop();
+	// Runs one queued task if there is one, returns false if the queue was empty
+	bool run_one_task();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable task_added;
+	std::condition_variable task_done;
+	bool stopping = false;
+};
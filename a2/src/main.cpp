@@ -9,10 +9,20 @@
 #include "ai_system.hpp"
 #include "physics_system.hpp"
 #include "render_system.hpp"
+#include "sim_clock.hpp"
+#include "spatial_index.hpp"
 #include "world_system.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
+// Simulation configuration, with a fixed timestep the world, AI, and physics advance in
+// constant steps and the renderer interpolates between the last two of them
+const bool USE_FIXED_TIMESTEP = true;
+const float SIMULATION_TICK_HZ = 60.f;
+const int MAX_STEPS_PER_FRAME = 5;
+// The AI decides less often than the simulation steps, with all the time since its last tick
+const float AI_TICK_HZ = 15.f;
+
 // Entry point
 int main()
 {
@@ -34,8 +44,27 @@ int main()
 	// initialize the main systems
 	renderer.init(window);
 	world.init(&renderer);
+	ai.init();
+
+	FixedStepClock sim_clock(SIMULATION_TICK_HZ, MAX_STEPS_PER_FRAME);
 
-	// variable timestep loop
+	// The systems in the order they step, the world and physics every step and the AI at its own rate.
+	// Between AI ticks the agents keep the velocities it set.
+	MultiRateClock system_clocks;
+	system_clocks.add_system([&world](float step_ms) {
+		world.step(step_ms);
+		spatial_index.update();
+	});
+	system_clocks.add_system([&world, &ai](float step_ms) {
+		ai.set_update_interval(world.get_ai_update_ticks());
+		ai.step(step_ms);
+	}, AI_TICK_HZ, 0.f, CATCH_UP_ID::ACCUMULATED);
+	system_clocks.add_system([&world, &physics](float step_ms) {
+		physics.step(step_ms);
+		world.handle_collisions();
+	});
+
+	// variable or fixed timestep loop
 	auto t = Clock::now();
 	while (!world.is_over()) {
 		// Processes system messages, if this wasn't present the window would become unresponsive
@@ -47,10 +76,20 @@ int main()
 			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
 		t = now;
 
-		world.step(elapsed_ms);
-		ai.step(elapsed_ms);
-		physics.step(elapsed_ms);
-		world.handle_collisions();
+		if (USE_FIXED_TIMESTEP)
+		{
+			int steps = sim_clock.advance(elapsed_ms);
+			for (int i = 0; i < steps; i++)
+			{
+				store_previous_motions();
+				system_clocks.advance(sim_clock.get_step_ms());
+			}
+			renderer.set_interpolation(sim_clock.get_alpha());
+		}
+		else
+		{
+			system_clocks.advance(elapsed_ms);
+		}
 
 		renderer.draw();
 
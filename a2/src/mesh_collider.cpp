@@ -0,0 +1,192 @@
+// internal
+#include "components.hpp"
+
+// Maximum number of triangles in a BVH leaf
+const int BVH_LEAF_SIZE = 4;
+
+namespace {
+	float cross(vec2 o, vec2 a, vec2 b)
+	{
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	}
+
+	// Separating axis test along the edge normals of polygon a
+	bool has_separating_axis(const vec2* a, int na, const vec2* b, int nb)
+	{
+		for (int i = 0; i < na; i++)
+		{
+			vec2 edge = a[(i + 1) % na] - a[i];
+			vec2 axis = { -edge.y, edge.x };
+			if (axis.x == 0.f && axis.y == 0.f)
+				continue; // degenerate edge
+
+			float min_a = dot(axis, a[0]), max_a = min_a;
+			for (int k = 1; k < na; k++)
+			{
+				float p = dot(axis, a[k]);
+				min_a = std::min(min_a, p);
+				max_a = std::max(max_a, p);
+			}
+			float min_b = dot(axis, b[0]), max_b = min_b;
+			for (int k = 1; k < nb; k++)
+			{
+				float p = dot(axis, b[k]);
+				min_b = std::min(min_b, p);
+				max_b = std::max(max_b, p);
+			}
+			if (max_a < min_b || max_b < min_a)
+				return true;
+		}
+		return false;
+	}
+
+	// Two convex polygons in 2D overlap if no edge normal of either separates them
+	bool convex_overlap(const vec2* a, int na, const vec2* b, int nb)
+	{
+		return !has_separating_axis(a, na, b, nb) && !has_separating_axis(b, nb, a, na);
+	}
+
+	struct BuildTriangle
+	{
+		vec2 corners[3];
+		vec2 centroid;
+	};
+
+	void build_node(std::vector<MeshCollider::Node>& nodes, std::vector<BuildTriangle>& triangles, int begin, int end)
+	{
+		int node_id = (int)nodes.size();
+		nodes.push_back(MeshCollider::Node());
+
+		vec2 min_corner = triangles[begin].corners[0], max_corner = min_corner;
+		vec2 min_centroid = triangles[begin].centroid, max_centroid = min_centroid;
+		for (int i = begin; i < end; i++)
+		{
+			for (const vec2& corner : triangles[i].corners)
+			{
+				min_corner = glm::min(min_corner, corner);
+				max_corner = glm::max(max_corner, corner);
+			}
+			min_centroid = glm::min(min_centroid, triangles[i].centroid);
+			max_centroid = glm::max(max_centroid, triangles[i].centroid);
+		}
+		nodes[node_id].min = min_corner;
+		nodes[node_id].max = max_corner;
+
+		if (end - begin <= BVH_LEAF_SIZE)
+		{
+			nodes[node_id].first = begin;
+			nodes[node_id].count = end - begin;
+			return;
+		}
+
+		// Median split along the longest axis of the centroid bounds
+		vec2 extent = max_centroid - min_centroid;
+		int axis = extent.x >= extent.y ? 0 : 1;
+		int mid = (begin + end) / 2;
+		std::nth_element(triangles.begin() + begin, triangles.begin() + mid, triangles.begin() + end,
+			[axis](const BuildTriangle& a, const BuildTriangle& b) { return a.centroid[axis] < b.centroid[axis]; });
+
+		// The left child directly follows its parent
+		build_node(nodes, triangles, begin, mid);
+		nodes[node_id].first = (int)nodes.size();
+		nodes[node_id].count = 0;
+		build_node(nodes, triangles, mid, end);
+	}
+}
+
+void MeshCollider::build(const std::vector<ColoredVertex>& vertices, const std::vector<uint16_t>& vertex_indices)
+{
+	hull.clear();
+	triangles.clear();
+	nodes.clear();
+	mask = SpriteMask();
+	if (vertices.empty() || vertex_indices.size() < 3)
+		return;
+
+	// Convex hull of the projected vertices (Andrew's monotone chain), counter-clockwise
+	std::vector<vec2> points;
+	points.reserve(vertices.size());
+	for (const ColoredVertex& vertex : vertices)
+		points.push_back({ vertex.position.x, vertex.position.y });
+	std::sort(points.begin(), points.end(), [](vec2 a, vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	hull.resize(2 * points.size());
+	size_t k = 0;
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0)
+			k--;
+		hull[k++] = points[i];
+	}
+	for (size_t i = points.size() - 1, lower = k + 1; i > 0; i--)
+	{
+		while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0)
+			k--;
+		hull[k++] = points[i - 1];
+	}
+	hull.resize(k > 1 ? k - 1 : k); // the last point equals the first
+
+	// Triangle BVH
+	std::vector<BuildTriangle> build_triangles(vertex_indices.size() / 3);
+	for (size_t t = 0; t < build_triangles.size(); t++)
+	{
+		BuildTriangle& triangle = build_triangles[t];
+		for (int c = 0; c < 3; c++)
+		{
+			const vec3& position = vertices[vertex_indices[3 * t + c]].position;
+			triangle.corners[c] = { position.x, position.y };
+		}
+		triangle.centroid = (triangle.corners[0] + triangle.corners[1] + triangle.corners[2]) / 3.f;
+	}
+	build_node(nodes, build_triangles, 0, (int)build_triangles.size());
+
+	triangles.reserve(3 * build_triangles.size());
+	for (const BuildTriangle& triangle : build_triangles)
+		triangles.insert(triangles.end(), triangle.corners, triangle.corners + 3);
+
+	// Rasterized for the pixel accurate tests against sprites
+	mask.build(*this);
+}
+
+bool MeshCollider::overlaps(const vec2 quad[4]) const
+{
+	if (empty())
+		return false;
+
+	// Early out against the convex hull
+	if (hull.size() >= 3 && !convex_overlap(hull.data(), (int)hull.size(), quad, 4))
+		return false;
+
+	vec2 quad_min = quad[0], quad_max = quad[0];
+	for (int i = 1; i < 4; i++)
+	{
+		quad_min = glm::min(quad_min, quad[i]);
+		quad_max = glm::max(quad_max, quad[i]);
+	}
+
+	// Descend the BVH and test the triangles of all overlapping leaves
+	int stack[64];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0)
+	{
+		const Node& node = nodes[stack[--stack_size]];
+		if (node.max.x < quad_min.x || quad_max.x < node.min.x || node.max.y < quad_min.y || quad_max.y < node.min.y)
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int t = node.first; t < node.first + node.count; t++)
+				if (convex_overlap(&triangles[3 * t], 3, quad, 4))
+					return true;
+		}
+		else
+		{
+			int node_id = (int)(&node - nodes.data());
+			stack[stack_size++] = node_id + 1;
+			stack[stack_size++] = node.first;
+		}
+	}
+	return false;
+}
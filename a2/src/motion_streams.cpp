@@ -0,0 +1,183 @@
+// internal
+#include "motion_streams.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "simd.hpp"
+
+// Distance of the left and right wall from the window border
+const float WALL_MARGIN = 30.f;
+
+void MotionStreams::resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	dest_x.resize(count);
+	dest_y.resize(count);
+	box_x.resize(count);
+	wall.resize(count);
+	entity_ids.resize(count, 0);
+	arrived.resize((count + 31) / 32);
+}
+
+void MotionStreams::gather(const std::vector<unsigned int>& indices)
+{
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	resize(indices.size());
+	for (uint k = 0; k < indices.size(); k++)
+	{
+		const Motion& motion = motion_container.components[indices[k]];
+		x[k] = motion.position.x;
+		y[k] = motion.position.y;
+		vx[k] = motion.velocity.x;
+		vy[k] = motion.velocity.y;
+		dest_x[k] = motion.destination.x;
+		dest_y[k] = motion.destination.y;
+		box_x[k] = abs(motion.scale.x);
+
+		// Only probe the mesh container if a different entity moved into this slot
+		Entity entity = motion_container.entities[indices[k]];
+		if (entity_ids[k] != (unsigned int)entity)
+		{
+			entity_ids[k] = entity;
+			wall[k] = registry.meshPtrs.has(entity) ? 1.f : 0.f;
+		}
+	}
+}
+
+void MotionStreams::scatter(const std::vector<unsigned int>& indices)
+{
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	assert(indices.size() == size());
+	for (uint k = 0; k < indices.size(); k++)
+	{
+		Motion& motion = motion_container.components[indices[k]];
+		motion.position = { x[k], y[k] };
+		motion.velocity = { vx[k], vy[k] };
+		if (arrived[k / 32] & (1u << (k % 32)))
+		{
+			motion.destination = { dest_x[k], dest_y[k] };
+			motion.in_motion = false;
+		}
+	}
+}
+
+static void integrate_range(MotionStreams& s, size_t begin, size_t end, float step_seconds)
+{
+	const float right_wall = window_width_px - WALL_MARGIN;
+	for (size_t i = begin; i < end; i++)
+	{
+		float sx = s.vx[i] * step_seconds;
+		float sy = s.vy[i] * step_seconds;
+		float x = s.x[i] + sx;
+		float y = s.y[i] + sy;
+
+		// Stop once the destination is closer than the distance travelled in this step
+		float travelled_sq = sx * sx + sy * sy;
+		float ex = x - s.dest_x[i];
+		float ey = y - s.dest_y[i];
+		float dest_sq = ex * ex + ey * ey;
+		if ((sx != 0.f || sy != 0.f) && dest_sq <= travelled_sq)
+		{
+			s.dest_x[i] = s.x[i];
+			s.dest_y[i] = s.y[i];
+			s.vx[i] = 0.f;
+			s.vy[i] = 0.f;
+			s.arrived[i / 32] |= 1u << (i % 32);
+		}
+
+		// bounce off the wall
+		if (s.wall[i] > 0.f)
+		{
+			if (x < WALL_MARGIN || s.box_x[i] < WALL_MARGIN)
+			{
+				x += WALL_MARGIN;
+				s.vx[i] = 0.f;
+			}
+			if (x > right_wall || s.box_x[i] > right_wall)
+			{
+				x -= WALL_MARGIN;
+				s.vx[i] = 0.f;
+			}
+		}
+
+		s.x[i] = x;
+		s.y[i] = y;
+	}
+}
+
+void integrate_motions_scalar(MotionStreams& streams, float step_seconds)
+{
+	std::fill(streams.arrived.begin(), streams.arrived.end(), 0u);
+	integrate_range(streams, 0, streams.size(), step_seconds);
+}
+
+void integrate_motions(MotionStreams& streams, float step_seconds)
+{
+	integrate_motions(streams, 0, streams.size(), step_seconds);
+}
+
+void integrate_motions(MotionStreams& streams, size_t begin, size_t end, float step_seconds)
+{
+	// The arrived words of this range, begin is a multiple of 32 so no other range shares them
+	assert(begin % 32 == 0);
+	std::fill(streams.arrived.begin() + begin / 32, streams.arrived.begin() + (end + 31) / 32, 0u);
+	size_t i = begin;
+
+#if SIMD_WIDTH > 1
+	const size_t simd_end = end - (end - begin) % SIMD_WIDTH;
+	const simd_float step = simd_set1(step_seconds);
+	const simd_float zero = simd_set1(0.f);
+	const simd_float margin = simd_set1(WALL_MARGIN);
+	const simd_float right_wall = simd_set1(window_width_px - WALL_MARGIN);
+	for (; i < simd_end; i += SIMD_WIDTH)
+	{
+		simd_float old_x = simd_load(&streams.x[i]);
+		simd_float old_y = simd_load(&streams.y[i]);
+		simd_float vx = simd_load(&streams.vx[i]);
+		simd_float vy = simd_load(&streams.vy[i]);
+
+		simd_float sx = simd_mul(vx, step);
+		simd_float sy = simd_mul(vy, step);
+		simd_float x = simd_add(old_x, sx);
+		simd_float y = simd_add(old_y, sy);
+
+		// destination arrival
+		simd_float travelled_sq = simd_add(simd_mul(sx, sx), simd_mul(sy, sy));
+		simd_float ex = simd_sub(x, simd_load(&streams.dest_x[i]));
+		simd_float ey = simd_sub(y, simd_load(&streams.dest_y[i]));
+		simd_float dest_sq = simd_add(simd_mul(ex, ex), simd_mul(ey, ey));
+		simd_mask moving = simd_or(simd_ne(sx, zero), simd_ne(sy, zero));
+		simd_mask arrived = simd_and(moving, simd_le(dest_sq, travelled_sq));
+		int arrived_bits = simd_movemask(arrived);
+		if (arrived_bits)
+		{
+			// rare, the lanes are handled one by one
+			simd_store(&streams.dest_x[i], simd_select(arrived, old_x, simd_load(&streams.dest_x[i])));
+			simd_store(&streams.dest_y[i], simd_select(arrived, old_y, simd_load(&streams.dest_y[i])));
+			vx = simd_select(arrived, zero, vx);
+			vy = simd_select(arrived, zero, vy);
+			for (int l = 0; l < SIMD_WIDTH; l++)
+				if (arrived_bits & (1 << l))
+					streams.arrived[(i + l) / 32] |= 1u << ((i + l) % 32);
+		}
+
+		// walls
+		simd_mask wall = simd_gt(simd_load(&streams.wall[i]), zero);
+		simd_float box = simd_load(&streams.box_x[i]);
+		simd_mask left = simd_and(wall, simd_or(simd_lt(x, margin), simd_lt(box, margin)));
+		x = simd_select(left, simd_add(x, margin), x);
+		vx = simd_select(left, zero, vx);
+		simd_mask right = simd_and(wall, simd_or(simd_gt(x, right_wall), simd_gt(box, right_wall)));
+		x = simd_select(right, simd_sub(x, margin), x);
+		vx = simd_select(right, zero, vx);
+
+		simd_store(&streams.x[i], x);
+		simd_store(&streams.y[i], y);
+		simd_store(&streams.vx[i], vx);
+		simd_store(&streams.vy[i], vy);
+	}
+#endif
+
+	integrate_range(streams, i, end, step_seconds);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Structure-of-arrays storage of the Motion components of the moving entities, slot k
+// corresponds to registry.motions.components[indices[k]]. The fields are split by how often the
+// integration touches them: the hot streams are read and written by every step,
+// the cold streams are only read by the arrival and wall tests.
+struct MotionStreams
+{
+	// hot
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+
+	// cold
+	std::vector<float> dest_x;
+	std::vector<float> dest_y;
+	std::vector<float> box_x; // abs(scale.x), the chicken also bounces if its box is out of the wall range
+	std::vector<float> wall; // 1 for entities that bounce off the left and right walls, 0 otherwise
+	std::vector<unsigned int> entity_ids; // to detect when the cached wall flag is stale
+
+	// Set by the integration, bit k of word k/32 is set if the entity in slot k arrived at its destination
+	std::vector<unsigned int> arrived;
+
+	void resize(size_t count);
+	size_t size() const { return x.size(); }
+
+	// Copy from and back to the Motion components at the given indices into registry.motions
+	void gather(const std::vector<unsigned int>& indices);
+	void scatter(const std::vector<unsigned int>& indices);
+};
+
+// Moves all entities by their velocity, stops entities that arrive at their destination,
+// and bounces wall entities off the left and right walls. One pass over contiguous floats,
+// 8 (AVX2) or 4 (SSE2/NEON) entities at a time.
+void integrate_motions(MotionStreams& streams, float step_seconds);
+// Same for the entities [begin, end) only, for splitting the streams across threads.
+// begin has to be a multiple of 32 such that ranges don't share words of the arrived bitset.
+void integrate_motions(MotionStreams& streams, size_t begin, size_t end, float step_seconds);
+
+// Scalar reference with the identical results
+void integrate_motions_scalar(MotionStreams& streams, float step_seconds);
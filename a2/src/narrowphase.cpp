@@ -0,0 +1,219 @@
+// internal
+#include "narrowphase.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "simd.hpp"
+
+// A body is fast if it moves more than this fraction of its bounding radius in one step
+const float FAST_BODY_FRACTION = 0.5f;
+
+void CollisionBodies::resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	start_x.resize(count);
+	start_y.resize(count);
+	radius_sq.resize(count);
+	fast.resize(count);
+	layer.resize(count);
+	mask.resize(count);
+	entity_ids.resize(count, 0);
+}
+
+void CollisionBodies::set_start(size_t i, const Motion& motion)
+{
+	start_x[i] = motion.position.x;
+	start_y[i] = motion.position.y;
+}
+
+void CollisionBodies::set(size_t i, Entity entity, const Motion& motion)
+{
+	x[i] = motion.position.x;
+	y[i] = motion.position.y;
+	// abs is to avoid negative scale due to the facing direction.
+	const vec2 half_box = vec2(abs(motion.scale.x), abs(motion.scale.y)) / 2.f;
+	radius_sq[i] = dot(half_box, half_box);
+	vec2 displacement = get_displacement(i);
+	fast[i] = dot(displacement, displacement) > FAST_BODY_FRACTION * FAST_BODY_FRACTION * radius_sq[i] ? 1 : 0;
+
+	// Only probe the filter container if a different entity moved into this slot
+	if (entity_ids[i] != (unsigned int)entity)
+	{
+		entity_ids[i] = entity;
+		CollisionFilter filter;
+		if (registry.collisionFilters.has(entity))
+			filter = registry.collisionFilters.get(entity);
+		layer[i] = filter.layer;
+		mask[i] = filter.mask;
+	}
+}
+
+AABB CollisionBodies::get_swept_aabb(size_t i) const
+{
+	const float radius = sqrt(radius_sq[i]);
+	AABB aabb;
+	aabb.min = { std::min(x[i], start_x[i]) - radius, std::min(y[i], start_y[i]) - radius };
+	aabb.max = { std::max(x[i], start_x[i]) + radius, std::max(y[i], start_y[i]) + radius };
+	return aabb;
+}
+
+// Tests pairs [begin, end) and appends the hits at hits[count], returns the new count
+static size_t circle_test_range(const BodyPair* pairs, size_t begin, size_t end, const CollisionBodies& bodies, unsigned int* hits, size_t count)
+{
+	const float* x = bodies.x.data();
+	const float* y = bodies.y.data();
+	const float* r2 = bodies.radius_sq.data();
+	for (size_t k = begin; k < end; k++)
+	{
+		unsigned int a = pairs[k].a;
+		unsigned int b = pairs[k].b;
+		float dx = x[a] - x[b];
+		float dy = y[a] - y[b];
+		float dist_squared = dx * dx + dy * dy;
+		float r_squared = r2[a] > r2[b] ? r2[a] : r2[b];
+		// branchless compaction, the slot is overwritten if the pair doesn't collide
+		hits[count] = (unsigned int)k;
+		count += dist_squared < r_squared ? 1 : 0;
+	}
+	return count;
+}
+
+void circle_narrowphase_scalar(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits)
+{
+	hits.resize(pairs.size());
+	size_t count = circle_test_range(pairs.data(), 0, pairs.size(), bodies, hits.data(), 0);
+	hits.resize(count);
+}
+
+void circle_narrowphase(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits)
+{
+	circle_narrowphase(pairs, 0, pairs.size(), bodies, hits);
+}
+
+void circle_narrowphase(const std::vector<BodyPair>& pairs, size_t begin, size_t end, const CollisionBodies& bodies, std::vector<unsigned int>& hits)
+{
+	hits.resize(end - begin);
+	unsigned int* out = hits.data();
+	size_t count = 0;
+	size_t k = begin;
+
+#if SIMD_WIDTH > 1
+	const size_t simd_end = end - (end - begin) % SIMD_WIDTH;
+	const float* x = bodies.x.data();
+	const float* y = bodies.y.data();
+	const float* r2 = bodies.radius_sq.data();
+	for (; k < simd_end; k += SIMD_WIDTH)
+	{
+		int mask;
+#if defined(SIMD_AVX2)
+		// Load 8 interleaved (a,b) pairs and split them into a and b lanes
+		const __m256i deinterleave = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+		__m256i lo = _mm256_loadu_si256((const __m256i*)&pairs[k]);
+		__m256i hi = _mm256_loadu_si256((const __m256i*)&pairs[k + 4]);
+		lo = _mm256_permutevar8x32_epi32(lo, deinterleave);
+		hi = _mm256_permutevar8x32_epi32(hi, deinterleave);
+		__m256i ia = _mm256_permute2x128_si256(lo, hi, 0x20);
+		__m256i ib = _mm256_permute2x128_si256(lo, hi, 0x31);
+
+		__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(x, ia, 4), _mm256_i32gather_ps(x, ib, 4));
+		__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(y, ia, 4), _mm256_i32gather_ps(y, ib, 4));
+		__m256 dist_squared = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		__m256 r_squared = _mm256_max_ps(_mm256_i32gather_ps(r2, ia, 4), _mm256_i32gather_ps(r2, ib, 4));
+		mask = _mm256_movemask_ps(_mm256_cmp_ps(dist_squared, r_squared, _CMP_LT_OQ));
+#else
+		// No gather instruction, assemble the lanes from scalar loads
+		alignas(16) float xa[4], xb[4], ya[4], yb[4], ra[4], rb[4];
+		for (int l = 0; l < 4; l++)
+		{
+			unsigned int a = pairs[k + l].a;
+			unsigned int b = pairs[k + l].b;
+			xa[l] = x[a]; xb[l] = x[b];
+			ya[l] = y[a]; yb[l] = y[b];
+			ra[l] = r2[a]; rb[l] = r2[b];
+		}
+#if defined(SIMD_SSE2)
+		__m128 dx = _mm_sub_ps(_mm_load_ps(xa), _mm_load_ps(xb));
+		__m128 dy = _mm_sub_ps(_mm_load_ps(ya), _mm_load_ps(yb));
+		__m128 dist_squared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		__m128 r_squared = _mm_max_ps(_mm_load_ps(ra), _mm_load_ps(rb));
+		mask = _mm_movemask_ps(_mm_cmplt_ps(dist_squared, r_squared));
+#elif defined(SIMD_NEON)
+		float32x4_t dx = vsubq_f32(vld1q_f32(xa), vld1q_f32(xb));
+		float32x4_t dy = vsubq_f32(vld1q_f32(ya), vld1q_f32(yb));
+		float32x4_t dist_squared = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+		float32x4_t r_squared = vmaxq_f32(vld1q_f32(ra), vld1q_f32(rb));
+		uint32x4_t lt = vcltq_f32(dist_squared, r_squared);
+		mask = (int)((vgetq_lane_u32(lt, 0) & 1) | (vgetq_lane_u32(lt, 1) & 2)
+			| (vgetq_lane_u32(lt, 2) & 4) | (vgetq_lane_u32(lt, 3) & 8));
+#endif
+#endif
+		// Compact the hit list
+		for (int l = 0; l < SIMD_WIDTH; l++)
+		{
+			out[count] = (unsigned int)(k + l);
+			count += (mask >> l) & 1;
+		}
+	}
+#endif
+
+	count = circle_test_range(pairs.data(), k, end, bodies, out, count);
+	hits.resize(count);
+}
+
+// Earliest time t in [0, 1] at which |d0 + t * (d1 - d0)| < radius, or a negative value if never
+static float swept_circle_toi(vec2 d0, vec2 d1, float r_squared)
+{
+	vec2 dd = d1 - d0;
+	float a = dot(dd, dd);
+	float b = dot(d0, dd);
+	float c = dot(d0, d0) - r_squared;
+	if (c < 0.f)
+		return 0.f; // already overlapping at the start
+	if (a == 0.f || b >= 0.f)
+		return -1.f; // not moving towards each other
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.f)
+		return -1.f; // the closest approach is farther than the radius
+	float t = (-b - sqrt(discriminant)) / a;
+	return t <= 1.f ? t : -1.f;
+}
+
+void swept_circle_narrowphase(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits, std::vector<float>& hit_times)
+{
+	swept_circle_narrowphase(pairs, 0, pairs.size(), bodies, hits, hit_times);
+}
+
+void swept_circle_narrowphase(const std::vector<BodyPair>& pairs, size_t begin, size_t end, const CollisionBodies& bodies, std::vector<unsigned int>& hits, std::vector<float>& hit_times)
+{
+	std::vector<unsigned int> end_hits;
+	end_hits.swap(hits);
+	hits.reserve(end_hits.size());
+	hit_times.clear();
+
+	// Merge the swept hits into the sorted end of step hits
+	size_t next_end_hit = 0;
+	for (size_t k = begin; k < end; k++)
+	{
+		if (next_end_hit < end_hits.size() && end_hits[next_end_hit] == k)
+		{
+			hits.push_back((unsigned int)k);
+			hit_times.push_back(1.f);
+			next_end_hit++;
+			continue;
+		}
+
+		unsigned int a = pairs[k].a;
+		unsigned int b = pairs[k].b;
+		if (!bodies.fast[a] && !bodies.fast[b])
+			continue;
+
+		vec2 d0 = { bodies.start_x[a] - bodies.start_x[b], bodies.start_y[a] - bodies.start_y[b] };
+		vec2 d1 = { bodies.x[a] - bodies.x[b], bodies.y[a] - bodies.y[b] };
+		float r_squared = std::max(bodies.radius_sq[a], bodies.radius_sq[b]);
+		float toi = swept_circle_toi(d0, d1, r_squared);
+		if (toi >= 0.f)
+		{
+			hits.push_back((unsigned int)k);
+			hit_times.push_back(toi);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "aabb_tree.hpp" // AABB
+
+// Candidate collision pair as indices into registry.motions, with a < b
+struct BodyPair
+{
+	unsigned int a;
+	unsigned int b;
+
+	bool operator<(const BodyPair& other) const
+	{
+		return a < other.a || (a == other.a && b < other.b);
+	}
+};
+
+// Structure-of-arrays copy of the per body data needed by the collision tests.
+// It is filled once per step, index i corresponds to registry.motions.components[i].
+struct CollisionBodies
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	// Position at the beginning of the step, before the integration
+	std::vector<float> start_x;
+	std::vector<float> start_y;
+	// Squared radius of the circle around the bounding box
+	std::vector<float> radius_sq;
+	// 1 if the body moved far relative to its size in this step, such that it may tunnel
+	std::vector<unsigned char> fast;
+	// Collision layer and mask, see CollisionFilter
+	std::vector<unsigned int> layer;
+	std::vector<unsigned int> mask;
+	std::vector<unsigned int> entity_ids; // to detect when the cached filter is stale
+
+	void resize(size_t count);
+	size_t size() const { return x.size(); }
+	void set_start(size_t i, const Motion& motion);
+	void set(size_t i, Entity entity, const Motion& motion);
+
+	// Box around the bounding circle at the start and at the end of the step
+	AABB get_swept_aabb(size_t i) const;
+	vec2 get_displacement(size_t i) const { return { x[i] - start_x[i], y[i] - start_y[i] }; }
+
+	// True if either body wants to collide with the other
+	bool should_test(unsigned int a, unsigned int b) const
+	{
+		return (layer[a] & mask[b]) != 0 || (layer[b] & mask[a]) != 0;
+	}
+	CollisionFilter get_filter(unsigned int i) const { return { layer[i], mask[i] }; }
+};
+
+// This is a SUPER APPROXIMATE check that puts a circle around the bounding boxes and sees
+// if the center point of either object is inside the other's bounding-box-circle.
+// Writes the indices of all colliding pairs to hits.
+// Evaluates 8 (AVX2) or 4 (SSE2/NEON) pairs at once, the remainder with the scalar version.
+void circle_narrowphase(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits);
+// Same for the pairs [begin, end) only, for splitting the candidates across threads
+void circle_narrowphase(const std::vector<BodyPair>& pairs, size_t begin, size_t end, const CollisionBodies& bodies, std::vector<unsigned int>& hits);
+
+// Scalar reference, produces the identical hit list
+void circle_narrowphase_scalar(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits);
+
+// Continuous collision detection for the pairs with a fast body that the circle test at the
+// end of the step missed. The bounding circles are swept along the bodies' displacement and the
+// pair is added to hits (keeping the order) if they touch at any time of the step.
+// hit_times receives the time of impact of every hit as a fraction of the step, 1 for the hits
+// found at the end of the step.
+void swept_circle_narrowphase(const std::vector<BodyPair>& pairs, const CollisionBodies& bodies, std::vector<unsigned int>& hits, std::vector<float>& hit_times);
+void swept_circle_narrowphase(const std::vector<BodyPair>& pairs, size_t begin, size_t end, const CollisionBodies& bodies, std::vector<unsigned int>& hits, std::vector<float>& hit_times);
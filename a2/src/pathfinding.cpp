@@ -0,0 +1,301 @@
+// internal
+#include "pathfinding.hpp"
+
+// stlib
+#include <queue>
+#include <cfloat>
+
+// The cache is dropped when it grows beyond this many paths
+const size_t MAX_CACHED_PATHS = 512;
+
+namespace {
+	const ivec2 NO_CELL = { -1, -1 };
+
+	// Path length with straight and diagonal steps and no obstacles, the A* heuristic
+	float octile_distance(ivec2 a, ivec2 b)
+	{
+		int dx = abs(a.x - b.x), dy = abs(a.y - b.y);
+		return (float)(dx + dy) + (sqrtf(2.f) - 2.f) * (float)std::min(dx, dy);
+	}
+
+	int sign(int v)
+	{
+		return (v > 0) - (v < 0);
+	}
+
+	struct JumpPointSearch
+	{
+		const PathGrid& grid;
+		ivec2 goal;
+
+		bool walkable(int x, int y) const { return grid.is_walkable(x, y); }
+
+		// Moves from (x, y) in direction (dx, dy) until a cell that the path may have to turn at,
+		// the goal, or an obstacle. Returns the cell or NO_CELL.
+		ivec2 jump(int x, int y, int dx, int dy) const
+		{
+			while (true)
+			{
+				if (!walkable(x, y))
+					return NO_CELL;
+				if (x == goal.x && y == goal.y)
+					return { x, y };
+				if (dx != 0 && dy != 0)
+				{
+					// A diagonal move stops where a straight move finds something
+					if (jump(x + dx, y, dx, 0) != NO_CELL || jump(x, y + dy, 0, dy) != NO_CELL)
+						return { x, y };
+				}
+				else if (dx != 0)
+				{
+					// Forced neighbours, the row above or below opens up behind a blocked cell
+					if ((walkable(x, y - 1) && !walkable(x - dx, y - 1)) || (walkable(x, y + 1) && !walkable(x - dx, y + 1)))
+						return { x, y };
+				}
+				else
+				{
+					if ((walkable(x - 1, y) && !walkable(x - 1, y - dy)) || (walkable(x + 1, y) && !walkable(x + 1, y - dy)))
+						return { x, y };
+				}
+				// No corner cutting, for straight moves this only checks the next cell
+				if (!walkable(x + dx, y) || !walkable(x, y + dy))
+					return NO_CELL;
+				x += dx;
+				y += dy;
+			}
+		}
+
+		// The directions worth following from a cell reached in direction (dx, dy), all for the start
+		void get_directions(int x, int y, int dx, int dy, std::vector<ivec2>& directions) const
+		{
+			directions.clear();
+			if (dx == 0 && dy == 0)
+			{
+				for (int ny = -1; ny <= 1; ny++)
+					for (int nx = -1; nx <= 1; nx++)
+						if ((nx != 0 || ny != 0) && walkable(x + nx, y + ny) && walkable(x + nx, y) && walkable(x, y + ny))
+							directions.push_back({ nx, ny });
+				return;
+			}
+			if (dx != 0 && dy != 0)
+			{
+				if (walkable(x, y + dy))
+					directions.push_back({ 0, dy });
+				if (walkable(x + dx, y))
+					directions.push_back({ dx, 0 });
+				if (walkable(x, y + dy) && walkable(x + dx, y))
+					directions.push_back({ dx, dy });
+			}
+			else if (dx != 0)
+			{
+				const bool next = walkable(x + dx, y), up = walkable(x, y - 1), down = walkable(x, y + 1);
+				if (next)
+				{
+					directions.push_back({ dx, 0 });
+					if (up)
+						directions.push_back({ dx, -1 });
+					if (down)
+						directions.push_back({ dx, 1 });
+				}
+				if (up)
+					directions.push_back({ 0, -1 });
+				if (down)
+					directions.push_back({ 0, 1 });
+			}
+			else
+			{
+				const bool next = walkable(x, y + dy), left = walkable(x - 1, y), right = walkable(x + 1, y);
+				if (next)
+				{
+					directions.push_back({ 0, dy });
+					if (left)
+						directions.push_back({ -1, dy });
+					if (right)
+						directions.push_back({ 1, dy });
+				}
+				if (left)
+					directions.push_back({ -1, 0 });
+				if (right)
+					directions.push_back({ 1, 0 });
+			}
+		}
+	};
+}
+
+bool PathfindingService::find_path(const PathGrid& grid, ivec2 start, ivec2 goal, std::vector<ivec2>& path)
+{
+	path.clear();
+	const int cell_count = grid.columns * grid.rows;
+	if (start.x < 0 || start.x >= grid.columns || start.y < 0 || start.y >= grid.rows || !grid.is_walkable(goal.x, goal.y))
+		return false;
+	if (start == goal)
+	{
+		path.push_back(start);
+		return true;
+	}
+
+	// A* over the jump points, the start may lie in a blocked cell
+	JumpPointSearch search = { grid, goal };
+	std::vector<float> cost(cell_count, FLT_MAX);
+	std::vector<int> parent(cell_count, -1);
+	std::vector<unsigned char> closed(cell_count, 0);
+	typedef std::pair<float, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	std::vector<ivec2> directions;
+
+	const int start_cell = start.y * grid.columns + start.x;
+	const int goal_cell = goal.y * grid.columns + goal.x;
+	cost[start_cell] = 0.f;
+	open.push({ octile_distance(start, goal), start_cell });
+	while (!open.empty())
+	{
+		const int cell = open.top().second;
+		open.pop();
+		if (closed[cell])
+			continue;
+		closed[cell] = 1;
+		if (cell == goal_cell)
+			break;
+
+		const ivec2 position = { cell % grid.columns, cell / grid.columns };
+		ivec2 direction = { 0, 0 };
+		if (parent[cell] >= 0)
+			direction = { sign(position.x - parent[cell] % grid.columns), sign(position.y - parent[cell] / grid.columns) };
+		search.get_directions(position.x, position.y, direction.x, direction.y, directions);
+		for (const ivec2& d : directions)
+		{
+			const ivec2 jump_point = search.jump(position.x + d.x, position.y + d.y, d.x, d.y);
+			if (jump_point == NO_CELL)
+				continue;
+			const int next = jump_point.y * grid.columns + jump_point.x;
+			if (closed[next])
+				continue;
+			const float next_cost = cost[cell] + octile_distance(position, jump_point);
+			if (next_cost < cost[next])
+			{
+				cost[next] = next_cost;
+				parent[next] = cell;
+				open.push({ next_cost + octile_distance(jump_point, goal), next });
+			}
+		}
+	}
+	if (!closed[goal_cell])
+		return false;
+
+	for (int cell = goal_cell; cell >= 0; cell = parent[cell])
+		path.push_back({ cell % grid.columns, cell / grid.columns });
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+PathfindingService::PathfindingService(unsigned int thread_count)
+{
+	// The pool's own thread is the caller's, which never waits for these searches
+	jobs.reset(new JobSystem(thread_count + 1));
+}
+
+PathfindingService::~PathfindingService()
+{
+	// Finishes the queued searches while the results can still be stored
+	jobs.reset();
+}
+
+void PathfindingService::set_grid(const FlowField& field)
+{
+	if (field.get_columns() == 0 || (grid && grid->version == field.get_version()))
+		return;
+
+	std::shared_ptr<PathGrid> snapshot = std::make_shared<PathGrid>();
+	snapshot->columns = field.get_columns();
+	snapshot->rows = field.get_rows();
+	snapshot->cell_size = FlowField::CELL_SIZE;
+	snapshot->version = field.get_version();
+	snapshot->blocked.resize(snapshot->columns * snapshot->rows);
+	for (int y = 0; y < snapshot->rows; y++)
+		for (int x = 0; x < snapshot->columns; x++)
+			snapshot->blocked[y * snapshot->columns + x] = field.is_blocked(x, y) ? 1 : 0;
+	grid = snapshot;
+	// The paths of older versions aren't asked for anymore, the tickets have their own keys
+	cache.clear();
+}
+
+void PathfindingService::update()
+{
+	std::vector<std::pair<PathKey, Result>> results;
+	{
+		std::lock_guard<std::mutex> lock(finished_mutex);
+		results.swap(finished);
+	}
+	for (auto& result : results)
+	{
+		pending.erase(result.first);
+		if (cache.size() >= MAX_CACHED_PATHS)
+			cache.clear();
+		cache[result.first] = std::move(result.second);
+	}
+}
+
+PathfindingService::PathKey PathfindingService::make_key(ivec2 start, ivec2 goal) const
+{
+	const PathKey start_cell = (PathKey)(start.y * grid->columns + start.x);
+	const PathKey goal_cell = (PathKey)(goal.y * grid->columns + goal.x);
+	return (start_cell & 0xFFFFF) | ((goal_cell & 0xFFFFF) << 20) | ((PathKey)(grid->version & 0xFFFFFF) << 40);
+}
+
+ivec2 PathfindingService::get_cell(vec2 position) const
+{
+	return {
+		std::min(std::max((int)floor(position.x / grid->cell_size), 0), grid->columns - 1),
+		std::min(std::max((int)floor(position.y / grid->cell_size), 0), grid->rows - 1) };
+}
+
+unsigned int PathfindingService::request_path(vec2 start, vec2 goal)
+{
+	if (!grid)
+		return 0;
+	const ivec2 start_cell = get_cell(start), goal_cell = get_cell(goal);
+	const PathKey key = make_key(start_cell, goal_cell);
+
+	unsigned int ticket = next_ticket++;
+	if (next_ticket == 0)
+		next_ticket = 1;
+	tickets[ticket] = key;
+
+	if (cache.count(key) == 0 && pending.count(key) == 0)
+	{
+		pending.insert(key);
+		std::shared_ptr<const PathGrid> snapshot = grid;
+		jobs->submit([this, snapshot, key, start_cell, goal_cell] {
+			Result result;
+			result.found = find_path(*snapshot, start_cell, goal_cell, result.path);
+			std::lock_guard<std::mutex> lock(finished_mutex);
+			finished.push_back({ key, std::move(result) });
+		});
+	}
+	return ticket;
+}
+
+PATH_STATUS_ID PathfindingService::get_path(unsigned int ticket, std::vector<vec2>& waypoints)
+{
+	auto it = tickets.find(ticket);
+	if (it == tickets.end())
+		return PATH_STATUS_ID::UNKNOWN_TICKET;
+	const PathKey key = it->second;
+	auto cached = cache.find(key);
+	if (cached == cache.end())
+	{
+		if (pending.count(key) > 0)
+			return PATH_STATUS_ID::PENDING;
+		// Dropped with the cache before it was picked up, ask again
+		tickets.erase(it);
+		return PATH_STATUS_ID::NOT_FOUND;
+	}
+	tickets.erase(it);
+
+	waypoints.clear();
+	if (!cached->second.found)
+		return PATH_STATUS_ID::NOT_FOUND;
+	for (const ivec2& cell : cached->second.path)
+		waypoints.push_back((vec2(cell) + 0.5f) * grid->cell_size);
+	return PATH_STATUS_ID::FOUND;
+}
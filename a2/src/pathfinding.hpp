@@ -0,0 +1,88 @@
+#pragma once
+
+// stlib
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "common.hpp"
+#include "flow_field.hpp"
+#include "job_system.hpp"
+
+// Snapshot of the occupancy grid of the flow field, shared read-only with the searches in flight
+struct PathGrid
+{
+	int columns = 0;
+	int rows = 0;
+	float cell_size = 1;
+	unsigned int version = 0;
+	std::vector<unsigned char> blocked;
+
+	bool is_walkable(int x, int y) const
+	{
+		return x >= 0 && x < columns && y >= 0 && y < rows && !blocked[y * columns + x];
+	}
+};
+
+enum class PATH_STATUS_ID {
+	PENDING = 0,
+	FOUND = PENDING + 1,
+	NOT_FOUND = FOUND + 1,
+	UNKNOWN_TICKET = NOT_FOUND + 1
+};
+
+// Grid paths for the AI, searched by jump point search A* on worker threads. Diagonal steps
+// may not cut the corners of blocked cells, the same moves as the distance fields of the flow
+// field. Finished paths are cached by (start cell, goal cell, grid version), so agents asking
+// for the same path share one search, and a new grid version drops the cache. An agent gets
+// a ticket for its request and can keep steering along its last path until the ticket is done.
+class PathfindingService
+{
+public:
+	// Number of threads searching in the background
+	explicit PathfindingService(unsigned int thread_count = 1);
+	~PathfindingService();
+
+	// Takes a new snapshot of the occupancy grid if its version changed
+	void set_grid(const FlowField& field);
+	// Moves the finished searches into the cache, once per frame
+	void update();
+
+	// Returns the ticket of the path, 0 if there is no grid yet
+	unsigned int request_path(vec2 start, vec2 goal);
+	// The waypoints are the world positions of the cells the path turns at, the last one is
+	// the goal. Once found or not found the ticket is used up.
+	PATH_STATUS_ID get_path(unsigned int ticket, std::vector<vec2>& waypoints);
+
+	// The search itself, a path of jump points from start to goal including both
+	static bool find_path(const PathGrid& grid, ivec2 start, ivec2 goal, std::vector<ivec2>& path);
+
+	size_t get_cached_count() const { return cache.size(); }
+	size_t get_pending_count() const { return pending.size(); }
+
+private:
+	struct Result
+	{
+		bool found;
+		std::vector<ivec2> path;
+	};
+	// Start cell, goal cell, and version, 20 bits per cell suffice for the window
+	typedef unsigned long long PathKey;
+	PathKey make_key(ivec2 start, ivec2 goal) const;
+	ivec2 get_cell(vec2 position) const;
+
+	std::shared_ptr<const PathGrid> grid;
+	std::unordered_map<PathKey, Result> cache;
+	std::unordered_set<PathKey> pending; // searches in flight
+	std::unordered_map<unsigned int, PathKey> tickets;
+	unsigned int next_ticket = 1;
+
+	// Written by the workers, read in update()
+	std::mutex finished_mutex;
+	std::vector<std::pair<PathKey, Result>> finished;
+
+	// Declared last such that the workers are joined before the rest is destroyed
+	std::unique_ptr<JobSystem> jobs;
+};
@@ -2,6 +2,16 @@
 #include "physics_system.hpp"
 #include "world_init.hpp"
 
+// Smallest amount of work handed to a thread, less is done inline.
+// The integration grain is a multiple of 32 for the arrived bitset of the motion streams.
+const size_t INTEGRATION_GRAIN = 256;
+const size_t QUERIER_GRAIN = 16;
+const size_t ENDPOINT_GRAIN = 512;
+const size_t NARROWPHASE_GRAIN = 1024;
+
+// A body falls asleep after resting for this many steps
+const unsigned int SLEEP_DELAY_STEPS = 30;
+
 // Returns the local bounding coordinates scaled by the current size of the entity
 vec2 get_bounding_box(const Motion& motion)
 {
@@ -9,104 +19,406 @@ vec2 get_bounding_box(const Motion& motion)
 	return { abs(motion.scale.x), abs(motion.scale.y) };
 }
 
-// This is a SUPER APPROXIMATE check that puts a circle around the bounding boxes and sees
-// if the center point of either object is inside the other's bounding-box-circle. You can
-// surely implement a more accurate detection
-bool collides(const Motion& motion1, const Motion& motion2)
-{
-	vec2 dp = motion1.position - motion2.position;
-	float dist_squared = dot(dp,dp);
-	const vec2 other_bonding_box = get_bounding_box(motion1) / 2.f;
-	const float other_r_squared = dot(other_bonding_box, other_bonding_box);
-	const vec2 my_bonding_box = get_bounding_box(motion2) / 2.f;
-	const float my_r_squared = dot(my_bonding_box, my_bonding_box);
-	const float r_squared = max(other_r_squared, my_r_squared);
-	if (dist_squared < r_squared)
-		return true;
-	return false;
-}
-
 // distance between 2 positions 
 float dist_to(const vec2 position1, const vec2 position2) {
 	return sqrt(pow(position2.x - position1.x, 2) + pow(position2.y - position1.y, 2));
 }
 
+// The collider of the entity's mesh, if it has one (only the chicken mesh is loaded from an .obj)
+const MeshCollider* get_mesh_collider(Entity entity)
+{
+	if (!registry.meshPtrs.has(entity))
+		return nullptr;
+	const MeshCollider& collider = registry.meshPtrs.get(entity)->collider;
+	return collider.empty() ? nullptr : &collider;
+}
+
+// The pixel coverage of the entity's sprite or mesh, if it has one
+const SpriteMask* get_sprite_mask(Entity entity)
+{
+	if (registry.spriteMaskPtrs.has(entity))
+	{
+		const SpriteMask* mask = registry.spriteMaskPtrs.get(entity);
+		return mask->empty() ? nullptr : mask;
+	}
+	const MeshCollider* collider = get_mesh_collider(entity);
+	return collider && !collider->mask.empty() ? &collider->mask : nullptr;
+}
+
+// Transforms the corners of the bounding box of quad_motion into the normalized mesh
+// space of mesh_motion, i.e., the inverse of the translate, rotate, scale chain of the renderer
+void get_quad_in_mesh_space(const Motion& quad_motion, const Motion& mesh_motion, vec2 out_quad[4])
+{
+	const vec2 corners[4] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+	const float c = cosf(quad_motion.angle), s = sinf(quad_motion.angle);
+	const float inv_c = cosf(-mesh_motion.angle), inv_s = sinf(-mesh_motion.angle);
+	for (int k = 0; k < 4; k++)
+	{
+		vec2 local = corners[k] * quad_motion.scale;
+		vec2 world = quad_motion.position + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+		vec2 d = world - mesh_motion.position;
+		out_quad[k] = vec2(inv_c * d.x - inv_s * d.y, inv_s * d.x + inv_c * d.y) / mesh_motion.scale;
+	}
+}
+
+// Refines a hit of the circle test if either entity has a mesh collider or both have a sprite mask
+bool mesh_collides(Entity entity_i, const Motion& motion_i, Entity entity_j, const Motion& motion_j)
+{
+	vec2 quad[4];
+	if (const MeshCollider* collider_i = get_mesh_collider(entity_i))
+	{
+		get_quad_in_mesh_space(motion_j, motion_i, quad);
+		if (!collider_i->overlaps(quad))
+			return false;
+	}
+	if (const MeshCollider* collider_j = get_mesh_collider(entity_j))
+	{
+		get_quad_in_mesh_space(motion_i, motion_j, quad);
+		if (!collider_j->overlaps(quad))
+			return false;
+	}
+
+	// Transparent parts of the sprites don't touch, only tested for upright and mirrored sprites
+	const SpriteMask* mask_i = get_sprite_mask(entity_i);
+	const SpriteMask* mask_j = get_sprite_mask(entity_j);
+	if (mask_i && mask_j && SpriteMask::supports(motion_i) && SpriteMask::supports(motion_j))
+		return mask_i->overlaps(motion_i, *mask_j, motion_j);
+	return true;
+}
+
+void PhysicsSystem::set_broadphase(BROADPHASE_ID id)
+{
+	assert(id != BROADPHASE_ID::BROADPHASE_COUNT);
+	if (id == broadphase)
+		return;
+	broadphase = id;
+
+	// The structures are rebuilt from scratch when selected again
+	tree.clear();
+	sweep_and_prune.clear();
+	broadphase_proxies.clear();
+}
+
+void PhysicsSystem::set_thread_count(unsigned int count)
+{
+	jobs.reset(new JobSystem(count));
+	chunk_buffers.clear();
+	chunk_buffers.resize(jobs->thread_count());
+}
+
+void PhysicsSystem::classify_bodies()
+{
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	const size_t size = motion_container.components.size();
+	slot_entities.resize(size, 0);
+	body_states.resize(size, BODY_STATE_ID::DYNAMIC);
+	rest_steps.resize(size, 0);
+	is_static_body.resize(size, 0);
+
+	dynamic_bodies.clear();
+	bool static_set_changed = false;
+	size_t resting_count = 0;
+	for (uint i = 0; i < size; i++)
+	{
+		Entity entity = motion_container.entities[i];
+		const Motion& motion = motion_container.components[i];
+
+		// Only probe the static container if a different entity moved into this slot
+		const bool moved_in = slot_entities[i] != (unsigned int)entity;
+		if (moved_in)
+		{
+			slot_entities[i] = entity;
+			rest_steps[i] = 0;
+			is_static_body[i] = registry.staticBodies.has(entity) ? 1 : 0;
+		}
+
+		BODY_STATE_ID state = BODY_STATE_ID::DYNAMIC;
+		if (is_static_body[i])
+			state = BODY_STATE_ID::STATIC;
+		else if (allow_sleeping && motion.velocity == vec2(0.f, 0.f) && !motion.in_motion)
+		{
+			rest_steps[i] = std::min(rest_steps[i] + 1, SLEEP_DELAY_STEPS);
+			if (rest_steps[i] == SLEEP_DELAY_STEPS)
+				state = BODY_STATE_ID::ASLEEP;
+		}
+		else
+			rest_steps[i] = 0;
+
+		const BODY_STATE_ID previous_state = body_states[i];
+		body_states[i] = state;
+		if (state == BODY_STATE_ID::DYNAMIC)
+		{
+			dynamic_bodies.push_back(i);
+			continue;
+		}
+
+		// Resting bodies are only (re-)inserted into the static tree if they are new to it or were moved from outside
+		resting_count++;
+		if (!moved_in && previous_state != BODY_STATE_ID::DYNAMIC && bodies.x[i] == motion.position.x && bodies.y[i] == motion.position.y)
+			continue;
+		bodies.set_start(i, motion);
+		bodies.set(i, entity, motion);
+		auto it = static_proxies.find(entity);
+		if (it == static_proxies.end())
+			static_proxies[entity] = static_tree.create_proxy(bodies.get_swept_aabb(i), i);
+		else
+		{
+			static_tree.set_user_data(it->second, i);
+			static_tree.move_proxy(it->second, bodies.get_swept_aabb(i), { 0.f, 0.f });
+		}
+		static_set_changed = true;
+	}
+
+	// Remove the bodies that woke up or no longer exist
+	if (!static_set_changed && static_proxies.size() == resting_count)
+		return;
+	for (auto it = static_proxies.begin(); it != static_proxies.end();)
+	{
+		// The index of a resting body is refreshed above whenever it changes
+		uint i = static_tree.get_user_data(it->second);
+		if (i < size && slot_entities[i] == it->first && body_states[i] != BODY_STATE_ID::DYNAMIC)
+		{
+			++it;
+			continue;
+		}
+		static_tree.destroy_proxy(it->second);
+		it = static_proxies.erase(it);
+	}
+}
+
+// Resting bodies are never tested against each other
+void PhysicsSystem::collect_pairs_static()
+{
+	if (static_proxies.empty())
+		return;
+
+	jobs->parallel_for(dynamic_bodies.size(), QUERIER_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+		ChunkBuffers& buffers = chunk_buffers[chunk];
+		for (size_t d = begin; d < end; d++)
+		{
+			uint i = dynamic_bodies[d];
+			static_tree.query(bodies.get_swept_aabb(i), [&](int proxy_id) {
+				uint j = static_tree.get_user_data(proxy_id);
+				if (bodies.should_test(i, j))
+					buffers.pairs.push_back({ std::min(i, j), std::max(i, j) });
+				return true;
+			}, buffers.scratch);
+		}
+	});
+
+	merge_candidate_pairs();
+}
+
+void PhysicsSystem::merge_candidate_pairs()
+{
+	for (ChunkBuffers& buffers : chunk_buffers)
+	{
+		candidate_pairs.insert(candidate_pairs.end(), buffers.pairs.begin(), buffers.pairs.end());
+		buffers.pairs.clear();
+	}
+	// Same order as the naive loop on a single thread, such that collisions are reported deterministically
+	std::sort(candidate_pairs.begin(), candidate_pairs.end());
+}
+
+// Test every entity that wants collisions against all other dynamic ones
+void PhysicsSystem::collect_pairs_naive()
+{
+	jobs->parallel_for(queriers.size(), QUERIER_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+		std::vector<BodyPair>& pairs = chunk_buffers[chunk].pairs;
+		for (size_t q = begin; q < end; q++)
+		{
+			uint i = queriers[q];
+			for (uint j : dynamic_bodies)
+			{
+				if (i == j || !bodies.should_test(i, j))
+					continue;
+				// a pair of two queriers is found from both sides, only keep it once
+				if (bodies.mask[j] != 0 && j < i)
+					continue;
+				pairs.push_back({ std::min(i, j), std::max(i, j) });
+			}
+		}
+	});
+
+	merge_candidate_pairs();
+}
+
+template <class Broadphase>
+void PhysicsSystem::sync_proxies(Broadphase& structure)
+{
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	step_count++;
+
+	for (uint i : dynamic_bodies)
+	{
+		Entity entity = motion_container.entities[i];
+		// Fast entities are covered along their whole path, for the continuous collision detection
+		const AABB aabb = bodies.get_swept_aabb(i);
+
+		auto it = broadphase_proxies.find(entity);
+		if (it == broadphase_proxies.end())
+		{
+			broadphase_proxies[entity] = { structure.create_proxy(aabb, i), step_count };
+			continue;
+		}
+		// The motion index changes when other entities are removed from the container
+		structure.set_user_data(it->second.proxy_id, i);
+		structure.move_proxy(it->second.proxy_id, aabb, bodies.get_displacement(i));
+		it->second.stamp = step_count;
+	}
+
+	// Remove the proxies of entities that no longer exist or came to rest
+	for (auto it = broadphase_proxies.begin(); it != broadphase_proxies.end();)
+	{
+		if (it->second.stamp != step_count)
+		{
+			structure.destroy_proxy(it->second.proxy_id);
+			it = broadphase_proxies.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+// Refit the dynamic AABB tree to the current motions and query it with every entity that wants collisions
+void PhysicsSystem::collect_pairs_aabb_tree()
+{
+	sync_proxies(tree);
+
+	jobs->parallel_for(queriers.size(), QUERIER_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+		ChunkBuffers& buffers = chunk_buffers[chunk];
+		for (size_t q = begin; q < end; q++)
+		{
+			uint i = queriers[q];
+			tree.query(bodies.get_swept_aabb(i), [&](int proxy_id) {
+				uint j = tree.get_user_data(proxy_id);
+				if (i != j && bodies.should_test(i, j) && !(bodies.mask[j] != 0 && j < i))
+					buffers.pairs.push_back({ std::min(i, j), std::max(i, j) });
+				return true;
+			}, buffers.scratch);
+		}
+	});
+
+	merge_candidate_pairs();
+}
+
+// Update the x-intervals, repair their order, and sweep slabs of the x-axis in parallel
+void PhysicsSystem::collect_pairs_sweep_and_prune()
+{
+	sync_proxies(sweep_and_prune);
+	sweep_and_prune.prepare_sweep();
+
+	jobs->parallel_for(sweep_and_prune.endpoint_count(), ENDPOINT_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+		ChunkBuffers& buffers = chunk_buffers[chunk];
+		sweep_and_prune.query_pairs(begin, end, buffers.scratch, [&](unsigned int i, unsigned int j) {
+			if (bodies.should_test(i, j))
+				buffers.pairs.push_back({ std::min(i, j), std::max(i, j) });
+		});
+	});
+
+	merge_candidate_pairs();
+}
+
 void PhysicsSystem::step(float elapsed_ms)
 {
 	// Move bug based on how much time has passed, this is to (partially) avoid
 	// having entities move at different speed based on the machine.
 	auto& motion_registry = registry.motions;
-	for (uint i = 0; i < motion_registry.size(); i++)
+
+	// Static and sleeping bodies are left out from here on
+	bodies.resize(motion_registry.components.size());
+	classify_bodies();
+
+	// Remember where every entity starts, for the continuous collision detection
+	for (uint i : dynamic_bodies)
+		bodies.set_start(i, motion_registry.components[i]);
+
+	if (use_motion_streams)
+	{
+		// Same integration as below, over the structure-of-arrays copy of the motions,
+		// in chunks across the threads
+		const float step_seconds = elapsed_ms / 1000.f;
+		motion_streams.gather(dynamic_bodies);
+		jobs->parallel_for(motion_streams.size(), INTEGRATION_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+			(void)chunk;
+			integrate_motions(motion_streams, begin, end, step_seconds);
+		});
+		motion_streams.scatter(dynamic_bodies);
+	}
+	else
 	{
-		// !!! TODO A1: update motion.position based on step_seconds and motion.velocity
-		//Motion& motion = motion_registry.components[i];
-		//Entity entity = motion_registry.entities[i];
-		//float step_seconds = elapsed_ms / 1000.f;
-		//(void)elapsed_ms; // placeholder to silence unused warning until implemented
-		// Eagles should move to the bottom of the screen while the chicken stays stationairy with velocity 
-		// {0,0}
-		Motion& motion = motion_registry.components[i];
-		Entity entity = motion_registry.entities[i];
-		float step_seconds = elapsed_ms / 1000.f;
-		vec2 position = motion.position;
-		vec2 velocity = motion.velocity;
-		vec2 dest = motion.destination;
-		float velocity_magnitude = sqrt(pow(velocity.x * step_seconds, 2) + pow(velocity.y * step_seconds, 2));
-		vec2 pos_final = { position.x + (velocity.x * step_seconds), position.y + (velocity.y * step_seconds) };
-		// behaviour if currently moving
-		if (velocity.x * step_seconds != 0 || velocity.y * step_seconds != 0) {
+		for (uint i : dynamic_bodies)
+		{
+			// !!! TODO A1: update motion.position based on step_seconds and motion.velocity
+			//Motion& motion = motion_registry.components[i];
+			//Entity entity = motion_registry.entities[i];
+			//float step_seconds = elapsed_ms / 1000.f;
+			//(void)elapsed_ms; // placeholder to silence unused warning until implemented
+			// Eagles should move to the bottom of the screen while the chicken stays stationairy with velocity 
+			// {0,0}
+			Motion& motion = motion_registry.components[i];
+			Entity entity = motion_registry.entities[i];
+			float step_seconds = elapsed_ms / 1000.f;
+			vec2 position = motion.position;
+			vec2 velocity = motion.velocity;
+			vec2 dest = motion.destination;
+			float velocity_magnitude = sqrt(pow(velocity.x * step_seconds, 2) + pow(velocity.y * step_seconds, 2));
+			vec2 pos_final = { position.x + (velocity.x * step_seconds), position.y + (velocity.y * step_seconds) };
+			// behaviour if currently moving
+			if (velocity.x * step_seconds != 0 || velocity.y * step_seconds != 0) {
 
-			if (dist_to(pos_final, dest) <= velocity_magnitude) {
-				motion.velocity = { 0, 0 };
-				motion.destination = motion.position;
-				motion.in_motion = false;
+				if (dist_to(pos_final, dest) <= velocity_magnitude) {
+					motion.velocity = { 0, 0 };
+					motion.destination = motion.position;
+					motion.in_motion = false;
+				}
 			}
-		}
-		motion.position = pos_final;
+			motion.position = pos_final;
 
-		// BUG BOUNCE OFF THE WALL A2 Part 2 implmented here for chicken + bug put int AI 
-		/*if (registry.eatables.has(entity)) {
-			// left wall
-			if (motion.position.x < 30.0f) {
-				//printf("hello");
-				motion.position.x += 30.0f;
-				motion.position.y += 0;
-				//motion.velocity.y *= -10.0;
-				motion.velocity.x = motion.velocity.x*-1.0;
-				//motion.velocity.y *= -1.0; //hits wall goes down 
-			}
+			// BUG BOUNCE OFF THE WALL A2 Part 2 implmented here for chicken + bug put int AI 
+			/*if (registry.eatables.has(entity)) {
+				// left wall
+				if (motion.position.x < 30.0f) {
+					//printf("hello");
+					motion.position.x += 30.0f;
+					motion.position.y += 0;
+					//motion.velocity.y *= -10.0;
+					motion.velocity.x = motion.velocity.x*-1.0;
+					//motion.velocity.y *= -1.0; //hits wall goes down 
+				}
 
-			if (motion.position.x > window_width_px - 30.0f) {
-				//printf("bye");
-				motion.position.x += -30.0f;
-				motion.position.y += 0;
-				motion.velocity.x = motion.velocity.x*-1.0;
-				//motion.velocity.y =10.0; //hits wall goes down 
-			}
-		}*/
+				if (motion.position.x > window_width_px - 30.0f) {
+					//printf("bye");
+					motion.position.x += -30.0f;
+					motion.position.y += 0;
+					motion.velocity.x = motion.velocity.x*-1.0;
+					//motion.velocity.y =10.0; //hits wall goes down 
+				}
+			}*/
 
-		// bounce chicken off the wall 
-		if (registry.meshPtrs.has(entity)) {
-			float xbox = get_bounding_box(registry.motions.get(entity)).x;
-			float ybox = get_bounding_box(registry.motions.get(entity)).y;
-			//printf("%d position x of entity chicken is : \n", motion.position.x);
-			//printf("%d xbox of entity chicken is : \n", ybox);
-			if (motion.position.x < 30.0f || xbox < 30.0f) {
-				//printf("hello"); left
-				motion.position.x += 30.0f;
-				motion.velocity.x = 0;
+			// bounce chicken off the wall 
+			if (registry.meshPtrs.has(entity)) {
+				float xbox = get_bounding_box(registry.motions.get(entity)).x;
+				float ybox = get_bounding_box(registry.motions.get(entity)).y;
+				//printf("%d position x of entity chicken is : \n", motion.position.x);
+				//printf("%d xbox of entity chicken is : \n", ybox);
+				if (motion.position.x < 30.0f || xbox < 30.0f) {
+					//printf("hello"); left
+					motion.position.x += 30.0f;
+					motion.velocity.x = 0;
 				
-			}
+				}
 
-			if (motion.position.x > window_width_px - 30.0f || xbox > window_width_px - 30.0f) {
-				//printf("bye"); right
-				motion.position.x += -30.0f;
-				motion.velocity.x = 0;
-				//motion.velocity.y = motion.velocity.y*
+				if (motion.position.x > window_width_px - 30.0f || xbox > window_width_px - 30.0f) {
+					//printf("bye"); right
+					motion.position.x += -30.0f;
+					motion.velocity.x = 0;
+					//motion.velocity.y = motion.velocity.y*
+				}
 			}
-		}
 
 
+		}
 	}
 
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -116,25 +428,64 @@ void PhysicsSystem::step(float elapsed_ms)
 
 	// Check for collisions between all moving entities
 	ComponentContainer<Motion> &motion_container = registry.motions;
-	for (uint i = 0; i < motion_container.components.size(); i++)
+
+	// Gather positions, radii, and collision filters once
+	queriers.clear();
+	for (uint i : dynamic_bodies)
 	{
-		Motion& motion_i = motion_container.components[i];
-		Entity entity_i = motion_container.entities[i];
+		bodies.set(i, motion_container.entities[i], motion_container.components[i]);
+		if (bodies.mask[i] != 0)
+			queriers.push_back(i);
+	}
 
-		// note starting j at i+1 to compare all (i,j) pairs only once (and to not compare with itself)
-		for (uint j = i + 1; j < motion_container.components.size(); j++)
+	// Find the candidates, pairs that no entity is interested in are skipped right away
+	candidate_pairs.clear();
+	if (broadphase == BROADPHASE_ID::AABB_TREE)
+		collect_pairs_aabb_tree();
+	else if (broadphase == BROADPHASE_ID::SWEEP_AND_PRUNE)
+		collect_pairs_sweep_and_prune();
+	else
+		collect_pairs_naive();
+	collect_pairs_static();
+
+	// Test the candidates in batches, then sweep the fast ones that were missed.
+	// Every chunk finds the hits of a range of the sorted candidates, so the concatenation is sorted too.
+	jobs->parallel_for(candidate_pairs.size(), NARROWPHASE_GRAIN, [&](size_t begin, size_t end, unsigned int chunk) {
+		ChunkBuffers& buffers = chunk_buffers[chunk];
+		circle_narrowphase(candidate_pairs, begin, end, bodies, buffers.hits);
+		swept_circle_narrowphase(candidate_pairs, begin, end, bodies, buffers.hits, buffers.hit_times);
+	});
+	hits.clear();
+	hit_times.clear();
+	for (ChunkBuffers& buffers : chunk_buffers)
+	{
+		hits.insert(hits.end(), buffers.hits.begin(), buffers.hits.end());
+		hit_times.insert(hit_times.end(), buffers.hit_times.begin(), buffers.hit_times.end());
+		buffers.hits.clear();
+		buffers.hit_times.clear();
+	}
+
+	contact_manager.begin_step();
+	for (uint h = 0; h < hits.size(); h++)
+	{
+		const BodyPair& pair = candidate_pairs[hits[h]];
+		Entity entity_i = motion_container.entities[pair.a];
+		Entity entity_j = motion_container.entities[pair.b];
+		// The circle test is only an early out for the chicken mesh, which is tested
+		// where the two entities were at the time of impact
+		Motion motion_i = motion_container.components[pair.a];
+		Motion motion_j = motion_container.components[pair.b];
+		if (hit_times[h] < 1.f)
 		{
-			Motion& motion_j = motion_container.components[j];
-			if (collides(motion_i, motion_j))
-			{
-				Entity entity_j = motion_container.entities[j];
-				// Create a collisions event
-				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-				registry.collisions.emplace_with_duplicates(entity_i, entity_j);
-				registry.collisions.emplace_with_duplicates(entity_j, entity_i);
-			}
+			motion_i.position -= (1.f - hit_times[h]) * bodies.get_displacement(pair.a);
+			motion_j.position -= (1.f - hit_times[h]) * bodies.get_displacement(pair.b);
 		}
+		if (!mesh_collides(entity_i, motion_i, entity_j, motion_j))
+			continue;
+		// The contact manager tells the entities that asked for it whether the contact is new
+		contact_manager.add(entity_i, entity_j, bodies.get_filter(pair.a), bodies.get_filter(pair.b));
 	}
+	contact_manager.end_step();
 
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// TODO A2: HANDLE CHICKEN - WALL collisions HERE
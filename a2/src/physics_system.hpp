@@ -1,9 +1,30 @@
 #pragma once
 
+// stlib
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "common.hpp"
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "aabb_tree.hpp"
+#include "sweep_and_prune.hpp"
+#include "narrowphase.hpp"
+#include "motion_streams.hpp"
+#include "job_system.hpp"
+#include "contact_manager.hpp"
+
+// The available algorithms to find candidate collision pairs.
+// NAIVE tests all (i,j) candidates, AABB_TREE uses a dynamic bounding volume tree
+// and SWEEP_AND_PRUNE sweeps along the persistently sorted x-axis intervals
+enum class BROADPHASE_ID {
+	NAIVE = 0,
+	AABB_TREE = NAIVE + 1,
+	SWEEP_AND_PRUNE = AABB_TREE + 1,
+	BROADPHASE_COUNT = SWEEP_AND_PRUNE + 1
+};
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -11,7 +32,101 @@ class PhysicsSystem
 public:
 	void step(float elapsed_ms);
 
+	// Select the algorithm used to find candidate pairs before the exact collision test
+	void set_broadphase(BROADPHASE_ID id);
+	BROADPHASE_ID get_broadphase() const { return broadphase; }
+
+	// Integrate the motions in structure-of-arrays form with the SIMD kernel (default)
+	// or directly on the Motion components
+	void set_motion_streams(bool enabled) { use_motion_streams = enabled; }
+
+	// Number of threads that integrate, find pairs, and test them, 1 runs the step on the
+	// calling thread and 0 uses all hardware threads. The per thread results are merged in
+	// a fixed order, so the collisions are the same for any thread count.
+	void set_thread_count(unsigned int count);
+	unsigned int get_thread_count() const { return jobs->thread_count(); }
+
+	// Put bodies to sleep that rested for a while, i.e., with zero velocity and no destination.
+	// Sleeping bodies are handled like static bodies until they are given a velocity again.
+	void set_sleeping(bool enabled) { allow_sleeping = enabled; }
+	// Number of static and sleeping bodies in the last step
+	size_t get_resting_count() const { return static_proxies.size(); }
+
 	PhysicsSystem()
 	{
+		set_thread_count(0);
 	}
-};
\ No newline at end of file
+
+private:
+	// Fill candidate_pairs with indices into registry.motions, skipping pairs
+	// that are filtered out by the collision layers
+	void collect_pairs_naive();
+	void collect_pairs_aabb_tree();
+	void collect_pairs_sweep_and_prune();
+
+	// Insert, move, and remove the proxies of a broadphase to match registry.motions
+	template <class Broadphase>
+	void sync_proxies(Broadphase& structure);
+
+	// Sorts the bodies into dynamic_bodies and the static tree, before the integration
+	void classify_bodies();
+	// Tests every dynamic body against the static tree
+	void collect_pairs_static();
+
+	// Concatenates the pairs found by every chunk and sorts them
+	void merge_candidate_pairs();
+
+	BROADPHASE_ID broadphase = BROADPHASE_ID::AABB_TREE;
+
+	bool use_motion_streams = true;
+	MotionStreams motion_streams;
+
+	// Static and sleeping bodies are not integrated and kept in their own tree, which only
+	// changes when a body falls asleep, wakes up, or is created or removed
+	enum class BODY_STATE_ID {
+		DYNAMIC = 0,
+		ASLEEP = DYNAMIC + 1,
+		STATIC = ASLEEP + 1
+	};
+	bool allow_sleeping = true;
+	// Per index into registry.motions
+	std::vector<unsigned int> slot_entities; // to detect when the cached state is stale
+	std::vector<BODY_STATE_ID> body_states;
+	std::vector<unsigned int> rest_steps; // consecutive steps without velocity
+	std::vector<unsigned char> is_static_body;
+	// The indices of the bodies that are integrated and tested against all others
+	std::vector<unsigned int> dynamic_bodies;
+	AABBTree static_tree;
+	std::unordered_map<unsigned int, int> static_proxies; // entity -> proxy in static_tree
+
+	// The broadphase structures and the proxy of every entity inserted into the active one
+	struct BroadphaseProxy
+	{
+		int proxy_id;
+		unsigned int stamp; // last step in which the entity still had a motion
+	};
+	AABBTree tree;
+	SweepAndPrune sweep_and_prune;
+	std::unordered_map<unsigned int, BroadphaseProxy> broadphase_proxies;
+	unsigned int step_count = 0;
+
+	// Candidate pairs of the current step, the per body data for testing them, and
+	// the indices of the candidates that do collide
+	std::vector<BodyPair> candidate_pairs;
+	CollisionBodies bodies;
+	// Dynamic bodies with a non-empty collision mask
+	std::vector<unsigned int> queriers;
+	std::vector<unsigned int> hits;
+	std::vector<float> hit_times;
+
+	std::unique_ptr<JobSystem> jobs;
+	// Output of every chunk of a parallel loop, merged in chunk order
+	struct ChunkBuffers
+	{
+		std::vector<BodyPair> pairs;
+		std::vector<unsigned int> hits;
+		std::vector<float> hit_times;
+		std::vector<int> scratch; // tree traversal stack, active list of the sweep
+	};
+	std::vector<ChunkBuffers> chunk_buffers;
+};
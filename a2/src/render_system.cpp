@@ -12,9 +12,19 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	// specification for more info Incrementally updates transformation matrix,
 	// thus ORDER IS IMPORTANT
 	Transform transform;
-	transform.translate(motion.position);
+	vec2 position = motion.position;
+	float angle = motion.angle;
+	if (registry.previousMotions.has(entity))
+	{
+		// Interpolate between the last two simulation steps, along the shorter arc for the angle
+		const PreviousMotion &previous = registry.previousMotions.get(entity);
+		position = mix(previous.position, motion.position, interpolation_alpha);
+		float turn = remainder(motion.angle - previous.angle, 2.f * (float)M_PI);
+		angle = previous.angle + turn * interpolation_alpha;
+	}
+	transform.translate(position);
 	// add Rotate
-	transform.rotate(motion.angle);
+	transform.rotate(angle);
 	transform.scale(motion.scale);
 	// !!! TODO A1: add rotation to the chain of transformations, mind the order
 	// of transformations
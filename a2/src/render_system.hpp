@@ -19,6 +19,8 @@ class RenderSystem {
 	 */
 	std::array<GLuint, texture_count> texture_gl_handles;
 	std::array<ivec2, texture_count> texture_dimensions;
+	// Alpha coverage of the textures for the pixel accurate collisions
+	std::array<SpriteMask, texture_count> texture_masks;
 
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
@@ -59,6 +61,7 @@ public:
 
 	void initializeGlMeshes();
 	Mesh& getMesh(GEOMETRY_BUFFER_ID id) { return meshes[(int)id]; };
+	SpriteMask& getTextureMask(TEXTURE_ASSET_ID id) { return texture_masks[(int)id]; };
 
 	void initializeGlGeometryBuffers();
 	// Initialize the screen texture used as intermediate render target
@@ -72,6 +75,9 @@ public:
 	// Draw all entities
 	void draw();
 
+	// Fraction between the previous and the current fixed step at which motions are drawn
+	void set_interpolation(float alpha) { interpolation_alpha = alpha; }
+
 	mat3 createProjectionMatrix();
 
 private:
@@ -88,6 +94,8 @@ private:
 	GLuint off_screen_render_buffer_depth;
 
 	Entity screen_state_entity;
+
+	float interpolation_alpha = 1.f;
 };
 
 bool loadEffectFromFile(
@@ -86,6 +86,7 @@ void RenderSystem::initializeGlTextures()
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		gl_has_errors();
+		texture_masks[i].build(data, dimensions.x, dimensions.y);
 		stbi_image_free(data);
     }
 	gl_has_errors();
@@ -130,6 +131,11 @@ void RenderSystem::initializeGlMeshes()
 			meshes[(int)geom_index].vertex_indices,
 			meshes[(int)geom_index].original_size);
 
+		// Precompute the collision hull and triangle hierarchy for the physics
+		meshes[(int)geom_index].collider.build(
+			meshes[(int)geom_index].vertices,
+			meshes[(int)geom_index].vertex_indices);
+
 		bindVBOandIBO(geom_index,
 			meshes[(int)geom_index].vertices, 
 			meshes[(int)geom_index].vertex_indices);
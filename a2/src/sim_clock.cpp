@@ -0,0 +1,106 @@
+// internal
+#include "sim_clock.hpp"
+#include "tiny_ecs_registry.hpp"
+
+FixedStepClock::FixedStepClock(float tick_rate_hz, int max_steps_per_frame)
+	: max_steps(max_steps_per_frame)
+	, accumulator_ms(0.f)
+{
+	set_tick_rate(tick_rate_hz);
+}
+
+void FixedStepClock::set_tick_rate(float tick_rate_hz)
+{
+	assert(tick_rate_hz > 0.f);
+	step_ms = 1000.f / tick_rate_hz;
+}
+
+int FixedStepClock::advance(float elapsed_ms)
+{
+	accumulator_ms += elapsed_ms;
+
+	int steps = (int)(accumulator_ms / step_ms);
+	if (steps > max_steps)
+	{
+		// Drop the time we can't catch up with, the game slows down instead
+		steps = max_steps;
+		accumulator_ms = 0.f;
+		return steps;
+	}
+	accumulator_ms = std::max(0.f, accumulator_ms - steps * step_ms);
+	return steps;
+}
+
+void store_previous_motions()
+{
+	for (uint i = 0; i < registry.motions.size(); i++)
+	{
+		Entity entity = registry.motions.entities[i];
+		const Motion& motion = registry.motions.components[i];
+		PreviousMotion& previous = registry.previousMotions.has(entity)
+			? registry.previousMotions.get(entity)
+			: registry.previousMotions.emplace(entity);
+		previous.position = motion.position;
+		previous.angle = motion.angle;
+	}
+}
+
+int MultiRateClock::add_system(SystemTick tick, float tick_rate_hz, float phase, CATCH_UP_ID catch_up, int max_steps)
+{
+	assert(tick_rate_hz >= 0.f && phase >= 0.f && max_steps > 0);
+	System system = { tick, 0.f, catch_up, max_steps, 0.f, 0.f, 0 };
+	systems.push_back(system);
+	set_tick_rate((int)systems.size() - 1, tick_rate_hz);
+	systems.back().due_ms = phase * systems.back().step_ms;
+	return (int)systems.size() - 1;
+}
+
+void MultiRateClock::set_tick_rate(int system, float tick_rate_hz)
+{
+	assert(tick_rate_hz >= 0.f);
+	System& s = systems[system];
+	const float step_ms = tick_rate_hz > 0.f ? 1000.f / tick_rate_hz : 0.f;
+	// The next tick keeps its place within the new period
+	s.due_ms = s.step_ms > 0.f ? std::min(s.due_ms, step_ms) : 0.f;
+	s.step_ms = step_ms;
+}
+
+void MultiRateClock::advance(float elapsed_ms)
+{
+	for (System& s : systems)
+	{
+		s.pending_ms += elapsed_ms;
+		s.due_ms -= elapsed_ms;
+		if (s.due_ms > 0.f)
+			continue;
+
+		if (s.step_ms == 0.f)
+		{
+			s.due_ms = 0.f;
+			s.ticks++;
+			s.tick(s.pending_ms);
+			s.pending_ms = 0.f;
+			continue;
+		}
+
+		// Periods due, the first one ends now
+		int steps = 1 + (int)(-s.due_ms / s.step_ms);
+		s.due_ms += steps * s.step_ms;
+		if (s.catch_up == CATCH_UP_ID::FIXED_STEPS)
+		{
+			// Like FixedStepClock, the time beyond max_steps is dropped
+			steps = std::min(steps, s.max_steps);
+			for (int i = 0; i < steps; i++)
+			{
+				s.ticks++;
+				s.tick(s.step_ms);
+			}
+		}
+		else
+		{
+			s.ticks++;
+			s.tick(s.catch_up == CATCH_UP_ID::ACCUMULATED ? s.pending_ms : s.step_ms);
+		}
+		s.pending_ms = 0.f;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// stlib
+#include <functional>
+#include <vector>
+
+#include "common.hpp"
+
+// Fixed timestep accumulator, see https://gafferongames.com/post/fix_your_timestep/
+// The frame time is accumulated and consumed in steps of constant length, such that the
+// simulation cost and results don't depend on the refresh rate. The remainder is used to
+// interpolate the rendering between the last two steps.
+class FixedStepClock
+{
+public:
+	FixedStepClock(float tick_rate_hz, int max_steps_per_frame);
+
+	void set_tick_rate(float tick_rate_hz);
+	float get_step_ms() const { return step_ms; }
+
+	// More steps than this per frame are dropped to not spiral to death on a slow machine
+	void set_max_steps(int max_steps_per_frame) { max_steps = max_steps_per_frame; }
+
+	// Adds the elapsed frame time and returns the number of steps to simulate
+	int advance(float elapsed_ms);
+
+	// Fraction of a step left in the accumulator, in [0, 1)
+	float get_alpha() const { return accumulator_ms / step_ms; }
+
+private:
+	float step_ms;
+	int max_steps;
+	float accumulator_ms;
+};
+
+enum class CATCH_UP_ID {
+	FIXED_STEPS = 0, // a tick per period due with the period as its delta, at most max_steps
+	ACCUMULATED = FIXED_STEPS + 1, // a single tick with all the time since the last one
+	DROP = ACCUMULATED + 1, // a single tick with the period as its delta, the time behind is lost
+	CATCH_UP_COUNT = DROP + 1
+};
+
+// Ticks several systems at their own rates from one stream of elapsed times, such that a
+// system that doesn't need every step (the AI) only runs when its period is due. The phase,
+// in periods, delays the first tick so that systems of the same rate can take turns, and the
+// catch-up policy decides what a system gets when more than one period passed. Due systems
+// tick in the order they were added. A tick rate of 0 ticks the system on every advance().
+class MultiRateClock
+{
+public:
+	typedef std::function<void(float elapsed_ms)> SystemTick;
+
+	// Returns the id of the system
+	int add_system(SystemTick tick, float tick_rate_hz = 0.f, float phase = 0.f,
+		CATCH_UP_ID catch_up = CATCH_UP_ID::ACCUMULATED, int max_steps = 5);
+	void set_tick_rate(int system, float tick_rate_hz);
+
+	// Adds the elapsed time to all clocks and ticks the systems that are due
+	void advance(float elapsed_ms);
+
+	unsigned int get_tick_count(int system) const { return systems[system].ticks; }
+
+private:
+	struct System
+	{
+		SystemTick tick;
+		float step_ms; // 0 for every advance()
+		CATCH_UP_ID catch_up;
+		int max_steps;
+		float due_ms; // until the next tick
+		float pending_ms; // since the last tick
+		unsigned int ticks;
+	};
+	std::vector<System> systems;
+};
+
+// Stores the current position and angle of all motions as their previous state,
+// called before every fixed step
+void store_previous_motions();
@@ -0,0 +1,95 @@
+#pragma once
+
+// Instruction set selection for the hand vectorized kernels.
+// AVX2 has to be enabled explicitly (CHICKEN_AVX2 in CMake), SSE2 is part of every
+// x86-64 target, and NEON of every 64-bit ARM target. Define CHICKEN_NO_SIMD to
+// force the scalar fallbacks, e.g., to compare results.
+#if defined(CHICKEN_NO_SIMD)
+#define SIMD_WIDTH 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#define SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#define SIMD_WIDTH 4
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#define SIMD_WIDTH 4
+#else
+#define SIMD_WIDTH 1
+#endif
+
+// Thin wrappers over the float lanes of the selected instruction set, such that a
+// kernel is written once. simd_mask holds all-ones lanes for true and zero for false.
+#if defined(SIMD_AVX2)
+typedef __m256 simd_float;
+typedef __m256 simd_mask;
+inline simd_float simd_load(const float* p) { return _mm256_loadu_ps(p); }
+inline void simd_store(float* p, simd_float a) { _mm256_storeu_ps(p, a); }
+inline simd_float simd_set1(float v) { return _mm256_set1_ps(v); }
+inline simd_float simd_add(simd_float a, simd_float b) { return _mm256_add_ps(a, b); }
+inline simd_float simd_sub(simd_float a, simd_float b) { return _mm256_sub_ps(a, b); }
+inline simd_float simd_mul(simd_float a, simd_float b) { return _mm256_mul_ps(a, b); }
+inline simd_float simd_div(simd_float a, simd_float b) { return _mm256_div_ps(a, b); }
+inline simd_float simd_min(simd_float a, simd_float b) { return _mm256_min_ps(a, b); }
+inline simd_float simd_max(simd_float a, simd_float b) { return _mm256_max_ps(a, b); }
+inline simd_float simd_sqrt(simd_float a) { return _mm256_sqrt_ps(a); }
+inline simd_mask simd_lt(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline simd_mask simd_le(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline simd_mask simd_gt(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline simd_mask simd_ne(simd_float a, simd_float b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+inline simd_mask simd_and(simd_mask a, simd_mask b) { return _mm256_and_ps(a, b); }
+inline simd_mask simd_or(simd_mask a, simd_mask b) { return _mm256_or_ps(a, b); }
+// Lanes of a where the mask is set, lanes of b otherwise
+inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { return _mm256_blendv_ps(b, a, m); }
+inline int simd_movemask(simd_mask m) { return _mm256_movemask_ps(m); }
+#elif defined(SIMD_SSE2)
+typedef __m128 simd_float;
+typedef __m128 simd_mask;
+inline simd_float simd_load(const float* p) { return _mm_loadu_ps(p); }
+inline void simd_store(float* p, simd_float a) { _mm_storeu_ps(p, a); }
+inline simd_float simd_set1(float v) { return _mm_set1_ps(v); }
+inline simd_float simd_add(simd_float a, simd_float b) { return _mm_add_ps(a, b); }
+inline simd_float simd_sub(simd_float a, simd_float b) { return _mm_sub_ps(a, b); }
+inline simd_float simd_mul(simd_float a, simd_float b) { return _mm_mul_ps(a, b); }
+inline simd_float simd_div(simd_float a, simd_float b) { return _mm_div_ps(a, b); }
+inline simd_float simd_min(simd_float a, simd_float b) { return _mm_min_ps(a, b); }
+inline simd_float simd_max(simd_float a, simd_float b) { return _mm_max_ps(a, b); }
+inline simd_float simd_sqrt(simd_float a) { return _mm_sqrt_ps(a); }
+inline simd_mask simd_lt(simd_float a, simd_float b) { return _mm_cmplt_ps(a, b); }
+inline simd_mask simd_le(simd_float a, simd_float b) { return _mm_cmple_ps(a, b); }
+inline simd_mask simd_gt(simd_float a, simd_float b) { return _mm_cmpgt_ps(a, b); }
+inline simd_mask simd_ne(simd_float a, simd_float b) { return _mm_cmpneq_ps(a, b); }
+inline simd_mask simd_and(simd_mask a, simd_mask b) { return _mm_and_ps(a, b); }
+inline simd_mask simd_or(simd_mask a, simd_mask b) { return _mm_or_ps(a, b); }
+inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline int simd_movemask(simd_mask m) { return _mm_movemask_ps(m); }
+#elif defined(SIMD_NEON)
+typedef float32x4_t simd_float;
+typedef uint32x4_t simd_mask;
+inline simd_float simd_load(const float* p) { return vld1q_f32(p); }
+inline void simd_store(float* p, simd_float a) { vst1q_f32(p, a); }
+inline simd_float simd_set1(float v) { return vdupq_n_f32(v); }
+inline simd_float simd_add(simd_float a, simd_float b) { return vaddq_f32(a, b); }
+inline simd_float simd_sub(simd_float a, simd_float b) { return vsubq_f32(a, b); }
+inline simd_float simd_mul(simd_float a, simd_float b) { return vmulq_f32(a, b); }
+inline simd_float simd_div(simd_float a, simd_float b) { return vdivq_f32(a, b); }
+inline simd_float simd_min(simd_float a, simd_float b) { return vminq_f32(a, b); }
+inline simd_float simd_max(simd_float a, simd_float b) { return vmaxq_f32(a, b); }
+inline simd_float simd_sqrt(simd_float a) { return vsqrtq_f32(a); }
+inline simd_mask simd_lt(simd_float a, simd_float b) { return vcltq_f32(a, b); }
+inline simd_mask simd_le(simd_float a, simd_float b) { return vcleq_f32(a, b); }
+inline simd_mask simd_gt(simd_float a, simd_float b) { return vcgtq_f32(a, b); }
+inline simd_mask simd_ne(simd_float a, simd_float b) { return vmvnq_u32(vceqq_f32(a, b)); }
+inline simd_mask simd_and(simd_mask a, simd_mask b) { return vandq_u32(a, b); }
+inline simd_mask simd_or(simd_mask a, simd_mask b) { return vorrq_u32(a, b); }
+inline simd_float simd_select(simd_mask m, simd_float a, simd_float b) { return vbslq_f32(m, a, b); }
+inline int simd_movemask(simd_mask m)
+{
+	return (int)((vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2)
+		| (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8));
+}
+#endif
@@ -0,0 +1,414 @@
+// internal
+#include "spatial_index.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "simd.hpp"
+
+SpatialIndex spatial_index;
+
+constexpr float SpatialIndex::CELL_SIZE;
+
+int SpatialIndex::cell_x(float position) const
+{
+	return std::min(std::max((int)floor(position / CELL_SIZE), 0), columns - 1);
+}
+
+int SpatialIndex::cell_y(float position) const
+{
+	return std::min(std::max((int)floor(position / CELL_SIZE), 0), rows - 1);
+}
+
+void SpatialIndex::update()
+{
+	columns = (int)ceil(window_width_px / CELL_SIZE);
+	rows = (int)ceil(window_height_px / CELL_SIZE);
+
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	const size_t count = motion_container.components.size();
+	slot_entities.resize(count, 0);
+	slot_layers.resize(count);
+	slot_cells.resize(count);
+
+	// Counting sort by cell
+	cell_start.assign(columns * rows + 1, 0);
+	for (uint i = 0; i < count; i++)
+	{
+		Entity entity = motion_container.entities[i];
+		if (slot_entities[i] != (unsigned int)entity)
+		{
+			slot_entities[i] = entity;
+			CollisionFilter filter;
+			if (registry.collisionFilters.has(entity))
+				filter = registry.collisionFilters.get(entity);
+			slot_layers[i] = filter.layer;
+		}
+		const vec2& position = motion_container.components[i].position;
+		slot_cells[i] = cell_y(position.y) * columns + cell_x(position.x);
+		cell_start[slot_cells[i] + 1]++;
+	}
+	for (size_t c = 1; c < cell_start.size(); c++)
+		cell_start[c] += cell_start[c - 1];
+
+	x.resize(count);
+	y.resize(count);
+	half_width.resize(count);
+	half_height.resize(count);
+	layer.resize(count);
+	ids.resize(count);
+	entities.resize(count);
+	max_half_extent = 0;
+	bounds_min = vec2(INFINITY);
+	bounds_max = vec2(-INFINITY);
+	std::vector<unsigned int> next(cell_start.begin(), cell_start.end() - 1);
+	for (uint i = 0; i < count; i++)
+	{
+		unsigned int k = next[slot_cells[i]]++;
+		const Motion& motion = motion_container.components[i];
+		x[k] = motion.position.x;
+		y[k] = motion.position.y;
+		// Bounding box of the rotated box
+		const float c = abs(cosf(motion.angle)), s = abs(sinf(motion.angle));
+		const vec2 size = abs(motion.scale);
+		half_width[k] = 0.5f * (c * size.x + s * size.y);
+		half_height[k] = 0.5f * (s * size.x + c * size.y);
+		max_half_extent = std::max(max_half_extent, std::max(half_width[k], half_height[k]));
+		bounds_min = glm::min(bounds_min, motion.position - vec2(half_width[k], half_height[k]));
+		bounds_max = glm::max(bounds_max, motion.position + vec2(half_width[k], half_height[k]));
+		layer[k] = slot_layers[i];
+		ids[k] = slot_entities[i];
+		entities[k] = motion_container.entities[i];
+	}
+}
+
+Ray make_segment(vec2 from, vec2 to, unsigned int ignore)
+{
+	Ray ray;
+	ray.origin = from;
+	ray.direction = to - from;
+	ray.max_distance = length(to - from);
+	ray.ignore = ignore;
+	return ray;
+}
+
+void SpatialIndex::query_radius(vec2 position, float radius, unsigned int mask, std::vector<Entity>& results) const
+{
+	results.clear();
+	if (size() == 0)
+		return;
+	const float radius_sq = radius * radius;
+	visit_cells(position - radius, position + radius, [&](unsigned int k) {
+		float dx = x[k] - position.x;
+		float dy = y[k] - position.y;
+		if ((layer[k] & mask) && dx * dx + dy * dy <= radius_sq)
+			results.push_back(entities[k]);
+	});
+}
+
+bool SpatialIndex::any_within(vec2 position, float radius, unsigned int mask) const
+{
+	if (size() == 0)
+		return false;
+	const float radius_sq = radius * radius;
+	bool found = false;
+	visit_cells(position - radius, position + radius, [&](unsigned int k) {
+		float dx = x[k] - position.x;
+		float dy = y[k] - position.y;
+		found |= (layer[k] & mask) && dx * dx + dy * dy <= radius_sq;
+	});
+	return found;
+}
+
+void SpatialIndex::query_aabb(const AABB& aabb, unsigned int mask, std::vector<Entity>& results) const
+{
+	results.clear();
+	if (size() == 0)
+		return;
+	visit_cells(aabb.min, aabb.max, [&](unsigned int k) {
+		if ((layer[k] & mask) && aabb.min.x <= x[k] && x[k] <= aabb.max.x && aabb.min.y <= y[k] && y[k] <= aabb.max.y)
+			results.push_back(entities[k]);
+	});
+}
+
+void SpatialIndex::nearest(vec2 position, size_t k, unsigned int mask, std::vector<Entity>& results) const
+{
+	results.clear();
+	if (size() == 0 || k == 0)
+		return;
+
+	// Search rings of cells around the cell of the position until no closer entity can follow.
+	// An entity in ring r + 1 is at least r cells away, also if it was clamped into a border cell.
+	std::vector<std::pair<float, unsigned int>> candidates;
+	const int cx = cell_x(position.x);
+	const int cy = cell_y(position.y);
+	const int max_ring = std::max(columns, rows);
+	for (int ring = 0; ring <= max_ring; ring++)
+	{
+		for (int y_cell = cy - ring; y_cell <= cy + ring; y_cell++)
+		{
+			if (y_cell < 0 || y_cell >= rows)
+				continue;
+			// Full rows at the top and bottom of the ring, only the two end cells in between
+			const bool full_row = y_cell == cy - ring || y_cell == cy + ring;
+			const int step = full_row ? 1 : std::max(2 * ring, 1);
+			for (int x_cell = cx - ring; x_cell <= cx + ring; x_cell += step)
+			{
+				if (x_cell < 0 || x_cell >= columns)
+					continue;
+				const int cell = y_cell * columns + x_cell;
+				for (unsigned int e = cell_start[cell]; e < cell_start[cell + 1]; e++)
+				{
+					if (!(layer[e] & mask))
+						continue;
+					float dx = x[e] - position.x;
+					float dy = y[e] - position.y;
+					candidates.push_back({ dx * dx + dy * dy, e });
+				}
+			}
+		}
+
+		if (candidates.size() >= k)
+		{
+			std::nth_element(candidates.begin(), candidates.begin() + (k - 1), candidates.end());
+			const float bound = ring * CELL_SIZE;
+			if (candidates[k - 1].first <= bound * bound)
+				break;
+		}
+	}
+
+	// Ties are broken by the index, such that the result doesn't depend on the search order
+	const size_t found = std::min(k, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + found, candidates.end());
+	for (size_t i = 0; i < found; i++)
+		results.push_back(entities[candidates[i].second]);
+}
+
+void SpatialIndex::any_within(const std::vector<vec2>& positions, float radius, unsigned int mask, std::vector<unsigned char>& results) const
+{
+	results.assign(positions.size(), 0);
+	if (size() == 0 || positions.empty())
+		return;
+
+	// The matching entities near any of the queries
+	vec2 min = positions[0], max = positions[0];
+	for (const vec2& position : positions)
+	{
+		min = glm::min(min, position);
+		max = glm::max(max, position);
+	}
+	target_x.clear();
+	target_y.clear();
+	visit_cells(min - radius, max + radius, [&](unsigned int k) {
+		if (layer[k] & mask)
+		{
+			target_x.push_back(x[k]);
+			target_y.push_back(y[k]);
+		}
+	});
+
+	// Spread out queries against many targets are better served by the grid one at a time
+	const size_t MAX_BATCH_TARGETS = 32;
+	if (target_x.size() > MAX_BATCH_TARGETS)
+	{
+		for (size_t q = 0; q < positions.size(); q++)
+			results[q] = any_within(positions[q], radius, mask) ? 1 : 0;
+		return;
+	}
+
+	const float radius_sq = radius * radius;
+	size_t q = 0;
+#if SIMD_WIDTH > 1
+	// Transpose the queries to lanes and test every target against SIMD_WIDTH queries at once
+	alignas(32) float qx[SIMD_WIDTH], qy[SIMD_WIDTH];
+	const simd_float r2 = simd_set1(radius_sq);
+	for (; q + SIMD_WIDTH <= positions.size(); q += SIMD_WIDTH)
+	{
+		for (int l = 0; l < SIMD_WIDTH; l++)
+		{
+			qx[l] = positions[q + l].x;
+			qy[l] = positions[q + l].y;
+		}
+		const simd_float px = simd_load(qx);
+		const simd_float py = simd_load(qy);
+		int hit_bits = 0;
+		for (size_t t = 0; t < target_x.size(); t++)
+		{
+			simd_float dx = simd_sub(simd_set1(target_x[t]), px);
+			simd_float dy = simd_sub(simd_set1(target_y[t]), py);
+			hit_bits |= simd_movemask(simd_le(simd_add(simd_mul(dx, dx), simd_mul(dy, dy)), r2));
+		}
+		for (int l = 0; l < SIMD_WIDTH; l++)
+			results[q + l] = (hit_bits >> l) & 1;
+	}
+#endif
+	for (; q < positions.size(); q++)
+	{
+		for (size_t t = 0; t < target_x.size(); t++)
+		{
+			float dx = target_x[t] - positions[q].x;
+			float dy = target_y[t] - positions[q].y;
+			if (dx * dx + dy * dy <= radius_sq)
+			{
+				results[q] = 1;
+				break;
+			}
+		}
+	}
+}
+
+namespace {
+	// A large finite value instead of an infinite one for axis parallel rays, such that 0 * inverse isn't NaN
+	float safe_inverse(float d)
+	{
+		return abs(d) > 1e-20f ? 1.f / d : (d < 0.f ? -1e30f : 1e30f);
+	}
+}
+
+void SpatialIndex::cast(const Ray& ray, unsigned int ray_index, unsigned int mask, bool all, std::vector<RayHit>& hits) const
+{
+	const float direction_length = length(ray.direction);
+	if (size() == 0 || direction_length == 0.f || !(ray.max_distance >= 0.f))
+		return;
+	const vec2 origin = ray.origin;
+	const vec2 direction = ray.direction / direction_length;
+	const vec2 inverse = { safe_inverse(direction.x), safe_inverse(direction.y) };
+
+	// Clip the ray to the bounds of all entities, it may be much longer
+	float t_begin = 0, t_end = ray.max_distance;
+	for (int axis = 0; axis < 2; axis++)
+	{
+		float t0 = (bounds_min[axis] - origin[axis]) * inverse[axis];
+		float t1 = (bounds_max[axis] - origin[axis]) * inverse[axis];
+		t_begin = std::max(t_begin, std::min(t0, t1));
+		t_end = std::min(t_end, std::max(t0, t1));
+	}
+	if (t_begin > t_end)
+		return;
+
+	float best = ray.max_distance;
+	int best_k = -1;
+	candidates.clear();
+
+	// Slab test of the ray against the box of entity k
+	auto test = [&](unsigned int k) {
+		if (!(layer[k] & mask) || ids[k] == ray.ignore)
+			return;
+		// In the same order of operations as the SIMD rejection
+		float t_x0 = (x[k] - origin.x - half_width[k]) * inverse.x, t_x1 = (x[k] - origin.x + half_width[k]) * inverse.x;
+		float t_y0 = (y[k] - origin.y - half_height[k]) * inverse.y, t_y1 = (y[k] - origin.y + half_height[k]) * inverse.y;
+		float t_min = std::max(std::max(std::min(t_x0, t_x1), std::min(t_y0, t_y1)), 0.f);
+		float t_max = std::min(std::max(t_x0, t_x1), std::max(t_y0, t_y1));
+		if (t_min > t_max || t_min > best)
+			return;
+		if (all)
+			candidates.push_back({ t_min, k });
+		else if (best_k < 0 || t_min < best || k < (unsigned int)best_k) // ties go to the lower index
+		{
+			best = t_min;
+			best_k = k;
+		}
+	};
+
+	// The entities [begin, end) are consecutive in the grid, SIMD_WIDTH boxes are rejected at once
+	auto test_range = [&](unsigned int begin, unsigned int end) {
+		unsigned int k = begin;
+#if SIMD_WIDTH > 1
+		const simd_float ox = simd_set1(origin.x), oy = simd_set1(origin.y);
+		const simd_float ix = simd_set1(inverse.x), iy = simd_set1(inverse.y);
+		const simd_float zero = simd_set1(0.f);
+		for (; k + SIMD_WIDTH <= end; k += SIMD_WIDTH)
+		{
+			const simd_float cx = simd_sub(simd_load(&x[k]), ox);
+			const simd_float cy = simd_sub(simd_load(&y[k]), oy);
+			const simd_float hw = simd_load(&half_width[k]);
+			const simd_float hh = simd_load(&half_height[k]);
+			const simd_float tx0 = simd_mul(simd_sub(cx, hw), ix), tx1 = simd_mul(simd_add(cx, hw), ix);
+			const simd_float ty0 = simd_mul(simd_sub(cy, hh), iy), ty1 = simd_mul(simd_add(cy, hh), iy);
+			const simd_float t_min = simd_max(simd_max(simd_min(tx0, tx1), simd_min(ty0, ty1)), zero);
+			const simd_float t_max = simd_min(simd_max(tx0, tx1), simd_max(ty0, ty1));
+			int lanes = simd_movemask(simd_and(simd_le(t_min, t_max), simd_le(t_min, simd_set1(best))));
+			for (int lane = 0; lanes != 0; lane++, lanes >>= 1)
+				if (lanes & 1)
+					test(k + lane);
+		}
+#endif
+		for (; k < end; k++)
+			test(k);
+	};
+
+	// March along the ray in steps of a cell. An entity whose box touches the ray at t has its
+	// position within max_half_extent of the ray point at t, so it is binned into a cell of the
+	// fattened step containing t. Once a hit is closer than the end of a step, no later cell can
+	// have a closer one. The cells of a row that a step adds form a range at either end of the
+	// range the previous steps visited.
+	row_visited_min.assign(rows, 0);
+	row_visited_max.assign(rows, -1);
+	for (float t0 = t_begin; ; t0 += CELL_SIZE)
+	{
+		const float t1 = std::min(t0 + CELL_SIZE, t_end);
+		const vec2 p0 = origin + direction * t0, p1 = origin + direction * t1;
+		const vec2 box_min = glm::min(p0, p1) - max_half_extent, box_max = glm::max(p0, p1) + max_half_extent;
+		const int x0 = cell_x(box_min.x), x1 = cell_x(box_max.x);
+		for (int cy = cell_y(box_min.y); cy <= cell_y(box_max.y); cy++)
+		{
+			const int visited_min = row_visited_min[cy], visited_max = row_visited_max[cy];
+			if (visited_min > visited_max)
+				test_range(cell_start[cy * columns + x0], cell_start[cy * columns + x1 + 1]);
+			else
+			{
+				if (x0 < visited_min)
+					test_range(cell_start[cy * columns + x0], cell_start[cy * columns + std::min(x1, visited_min - 1) + 1]);
+				if (x1 > visited_max)
+					test_range(cell_start[cy * columns + std::max(x0, visited_max + 1)], cell_start[cy * columns + x1 + 1]);
+			}
+			row_visited_min[cy] = visited_min > visited_max ? x0 : std::min(x0, visited_min);
+			row_visited_max[cy] = visited_min > visited_max ? x1 : std::max(x1, visited_max);
+		}
+		if ((!all && best_k >= 0 && best <= t1) || t1 >= t_end)
+			break;
+	}
+
+	auto add_hit = [&](unsigned int k, float t) {
+		const vec2 point = origin + direction * t;
+		vec2 normal = { 0, 0 };
+		if (t > 0.f)
+		{
+			// The side whose slab was entered last
+			float t_x = (x[k] - origin.x - (direction.x > 0.f ? half_width[k] : -half_width[k])) * inverse.x;
+			float t_y = (y[k] - origin.y - (direction.y > 0.f ? half_height[k] : -half_height[k])) * inverse.y;
+			if (t_x >= t_y)
+				normal.x = direction.x > 0.f ? -1.f : 1.f;
+			else
+				normal.y = direction.y > 0.f ? -1.f : 1.f;
+		}
+		hits.push_back({ entities[k], t, point, normal, ray_index });
+	};
+	if (all)
+	{
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+			return a.distance < b.distance || (a.distance == b.distance && a.k < b.k);
+		});
+		for (const Candidate& candidate : candidates)
+			add_hit(candidate.k, candidate.distance);
+	}
+	else if (best_k >= 0)
+		add_hit(best_k, best);
+}
+
+bool SpatialIndex::raycast(const Ray& ray, unsigned int mask, std::vector<RayHit>& hits) const
+{
+	hits.clear();
+	cast(ray, 0, mask, false, hits);
+	return !hits.empty();
+}
+
+void SpatialIndex::raycast_all(const Ray& ray, unsigned int mask, std::vector<RayHit>& hits) const
+{
+	hits.clear();
+	cast(ray, 0, mask, true, hits);
+}
+
+void SpatialIndex::raycast(const std::vector<Ray>& rays, unsigned int mask, std::vector<RayHit>& hits) const
+{
+	hits.clear();
+	for (size_t r = 0; r < rays.size(); r++)
+		cast(rays[r], (unsigned int)r, mask, false, hits);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+// stlib
+#include <cfloat>
+#include <vector>
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "aabb_tree.hpp" // AABB
+
+// A ray, or a segment of a ray, cast by a gameplay system
+struct Ray
+{
+	vec2 origin = { 0, 0 };
+	vec2 direction = { 1, 0 }; // normalized by the query
+	float max_distance = FLT_MAX;
+	unsigned int ignore = 0; // an entity that is never hit, e.g., the one casting
+};
+
+// The segment from one point to another
+Ray make_segment(vec2 from, vec2 to, unsigned int ignore = 0);
+
+struct RayHit
+{
+	Entity entity;
+	float distance; // 0 if the ray starts inside the entity
+	vec2 point;
+	vec2 normal; // of the side of the bounding box that was hit, 0 if the ray starts inside
+	unsigned int ray; // index of the ray in a batched query
+};
+
+// Spatial queries over the positions of all entities with a Motion, for the gameplay systems.
+// The entities are binned into a uniform grid over the window once per tick by update().
+// Positions outside the window go to the border cells, so the queries are exact everywhere.
+// The mask of a query is matched against the CollisionFilter layer of the entities.
+// Rays are tested against the bounding boxes of the entities (of the rotated box, if rotated).
+class SpatialIndex
+{
+public:
+	// Edge length of a grid cell, in pixels
+	static constexpr float CELL_SIZE = 64.f;
+
+	// Rebuilds the grid from registry.motions
+	void update();
+
+	// Entities within radius of position (inclusive)
+	void query_radius(vec2 position, float radius, unsigned int mask, std::vector<Entity>& results) const;
+	bool any_within(vec2 position, float radius, unsigned int mask) const;
+	// Up to k entities closest to position, sorted by distance
+	void nearest(vec2 position, size_t k, unsigned int mask, std::vector<Entity>& results) const;
+	// Entities whose position is inside the box
+	void query_aabb(const AABB& aabb, unsigned int mask, std::vector<Entity>& results) const;
+
+	// Batched any_within(), results[q] is 1 if an entity is within radius of positions[q].
+	// The queries are tested several at a time against the entities near any of them.
+	void any_within(const std::vector<vec2>& positions, float radius, unsigned int mask, std::vector<unsigned char>& results) const;
+
+	// The first entity along the ray, if any
+	bool raycast(const Ray& ray, unsigned int mask, std::vector<RayHit>& hits) const;
+	// All entities along the ray, sorted by distance
+	void raycast_all(const Ray& ray, unsigned int mask, std::vector<RayHit>& hits) const;
+	// The first hit of every ray that hits anything, in the order of the rays
+	void raycast(const std::vector<Ray>& rays, unsigned int mask, std::vector<RayHit>& hits) const;
+
+	size_t size() const { return x.size(); }
+
+private:
+	int cell_x(float position) const;
+	int cell_y(float position) const;
+
+	// Calls visit(k) for every entity k in the cells overlapping the box
+	template <class Visit>
+	void visit_cells(vec2 min, vec2 max, Visit visit) const;
+
+	// Walks the cells along the ray and tests their entities, see raycast()
+	void cast(const Ray& ray, unsigned int ray_index, unsigned int mask, bool all, std::vector<RayHit>& hits) const;
+
+	int columns = 0;
+	int rows = 0;
+	// cell c holds the entities [cell_start[c], cell_start[c + 1])
+	std::vector<unsigned int> cell_start;
+
+	// Sorted by cell
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> half_width;
+	std::vector<float> half_height;
+	std::vector<unsigned int> layer;
+	std::vector<unsigned int> ids;
+	std::vector<Entity> entities;
+	// Largest half extent and the bounds of all bounding boxes, to limit the cells a ray visits
+	float max_half_extent = 0;
+	vec2 bounds_min = { 0, 0 };
+	vec2 bounds_max = { 0, 0 };
+
+	// Per index into registry.motions, to only probe the filter container for new entities
+	std::vector<unsigned int> slot_entities;
+	std::vector<unsigned int> slot_layers;
+	std::vector<unsigned int> slot_cells;
+
+	// Scratch space of the batched query
+	mutable std::vector<float> target_x;
+	mutable std::vector<float> target_y;
+	// Scratch space of the ray queries
+	mutable std::vector<int> row_visited_min;
+	mutable std::vector<int> row_visited_max;
+	struct Candidate
+	{
+		float distance;
+		unsigned int k;
+	};
+	mutable std::vector<Candidate> candidates;
+};
+
+// Shared by all systems, updated once per tick
+extern SpatialIndex spatial_index;
+
+template <class Visit>
+void SpatialIndex::visit_cells(vec2 min, vec2 max, Visit visit) const
+{
+	const int x0 = cell_x(min.x), x1 = cell_x(max.x);
+	const int y0 = cell_y(min.y), y1 = cell_y(max.y);
+	for (int cy = y0; cy <= y1; cy++)
+	{
+		// The cells of a row are contiguous
+		unsigned int begin = cell_start[cy * columns + x0];
+		unsigned int end = cell_start[cy * columns + x1 + 1];
+		for (unsigned int k = begin; k < end; k++)
+			visit(k);
+	}
+}
@@ -0,0 +1,239 @@
+// internal
+#include "components.hpp"
+#include "simd.hpp"
+
+// Edge length of the cells the masks are resampled to for the pair test, in pixels
+const float WORLD_CELL_SIZE = 2.f;
+// Number of world scales remembered per mask
+const size_t MAX_SCALED_MASKS = 8;
+
+namespace {
+	// The scale with the rotation folded in, an upside down sprite is a mirrored one
+	vec2 get_upright_scale(const Motion& motion)
+	{
+		return cosf(motion.angle) < 0.f ? -motion.scale : motion.scale;
+	}
+
+	// Bits first ... last, inclusive
+	uint64_t bit_range(int first, int last)
+	{
+		uint64_t upper = last >= 63 ? ~0ull : (1ull << (last + 1)) - 1;
+		return upper & ~((1ull << first) - 1);
+	}
+
+	// Range of the blocks of a mask with the given count overlapped by the local interval, false if none
+	bool get_block_range(float local_min, float local_max, int count, int& first, int& last)
+	{
+		local_min = std::max(local_min, -0.5f);
+		local_max = std::min(local_max, 0.5f);
+		if (local_min >= local_max)
+			return false;
+		first = std::min((int)floor((local_min + 0.5f) * count), count - 1);
+		last = std::min((int)ceil((local_max + 0.5f) * count) - 1, count - 1);
+		return first <= last;
+	}
+
+	// Whether a[i] & ((lo[i] >> shift) | (hi[i] << (64 - shift))) is non-zero for any i < count.
+	// lo or hi are null where the word of the other mask is outside of it, hi is null if shift is 0.
+	bool any_common_bits(const uint64_t* a, const uint64_t* lo, const uint64_t* hi, int shift, int count)
+	{
+		int i = 0;
+#if defined(SIMD_AVX2)
+		const __m128i right = _mm_cvtsi32_si128(shift);
+		const __m128i left = _mm_cvtsi32_si128(64 - shift);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i b = _mm256_setzero_si256();
+			if (lo)
+				b = _mm256_srl_epi64(_mm256_loadu_si256((const __m256i*)(lo + i)), right);
+			if (hi)
+				b = _mm256_or_si256(b, _mm256_sll_epi64(_mm256_loadu_si256((const __m256i*)(hi + i)), left));
+			if (!_mm256_testz_si256(_mm256_loadu_si256((const __m256i*)(a + i)), b))
+				return true;
+		}
+#elif defined(SIMD_SSE2)
+		const __m128i right = _mm_cvtsi32_si128(shift);
+		const __m128i left = _mm_cvtsi32_si128(64 - shift);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i b = zero;
+			if (lo)
+				b = _mm_srl_epi64(_mm_loadu_si128((const __m128i*)(lo + i)), right);
+			if (hi)
+				b = _mm_or_si128(b, _mm_sll_epi64(_mm_loadu_si128((const __m128i*)(hi + i)), left));
+			__m128i common = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a + i)), b);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(common, zero)) != 0xFFFF)
+				return true;
+		}
+#elif defined(SIMD_NEON)
+		// Negative counts shift right, counts of 64 give 0
+		const int64x2_t right = vdupq_n_s64(-shift);
+		const int64x2_t left = vdupq_n_s64(64 - shift);
+		for (; i + 2 <= count; i += 2)
+		{
+			uint64x2_t b = vdupq_n_u64(0);
+			if (lo)
+				b = vshlq_u64(vld1q_u64((const uint64_t*)(lo + i)), right);
+			if (hi)
+				b = vorrq_u64(b, vshlq_u64(vld1q_u64((const uint64_t*)(hi + i)), left));
+			uint64x2_t common = vandq_u64(vld1q_u64((const uint64_t*)(a + i)), b);
+			if ((vgetq_lane_u64(common, 0) | vgetq_lane_u64(common, 1)) != 0)
+				return true;
+		}
+#endif
+		for (; i < count; i++)
+		{
+			uint64_t b = (lo ? lo[i] >> shift : 0) | (hi ? hi[i] << (64 - shift) : 0);
+			if (a[i] & b)
+				return true;
+		}
+		return false;
+	}
+}
+
+void SpriteMask::build(const unsigned char* rgba, int width, int height, unsigned char alpha_threshold)
+{
+	scaled.clear();
+	rows = 0;
+	bits.clear();
+	if (rgba == nullptr || width <= 0 || height <= 0)
+		return;
+
+	// Square blocks as far as the aspect ratio allows
+	rows = std::max(1, (int)lround((double)COLUMNS * height / width));
+	bits.assign(rows, 0);
+	for (int y = 0; y < height; y++)
+	{
+		uint64_t& row = bits[(size_t)y * rows / height];
+		const unsigned char* texel = rgba + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++, texel += 4)
+			if (texel[3] > alpha_threshold)
+				row |= 1ull << ((size_t)x * COLUMNS / width);
+	}
+}
+
+void SpriteMask::build(const MeshCollider& collider)
+{
+	scaled.clear();
+	rows = 0;
+	bits.clear();
+	if (collider.empty())
+		return;
+
+	rows = COLUMNS;
+	bits.assign(rows, 0);
+	const float block = 1.f / COLUMNS;
+	for (int r = 0; r < rows; r++)
+	{
+		for (int c = 0; c < COLUMNS; c++)
+		{
+			const vec2 min = { -0.5f + c * block, -0.5f + r * block };
+			const vec2 quad[4] = { min, { min.x + block, min.y }, min + block, { min.x, min.y + block } };
+			if (collider.overlaps(quad))
+				bits[r] |= 1ull << c;
+		}
+	}
+}
+
+bool SpriteMask::supports(const Motion& motion)
+{
+	return abs(sinf(motion.angle)) < 1e-4f;
+}
+
+const SpriteMask::Scaled& SpriteMask::get_scaled(vec2 scale) const
+{
+	// Replaced round robin once full, the storage never moves
+	if (scaled.capacity() < MAX_SCALED_MASKS)
+		scaled.reserve(MAX_SCALED_MASKS);
+	for (const Scaled& entry : scaled)
+		if (entry.scale == scale)
+			return entry;
+	Scaled* entry;
+	if (scaled.size() < MAX_SCALED_MASKS)
+	{
+		scaled.emplace_back();
+		entry = &scaled.back();
+	}
+	else
+	{
+		entry = &scaled[next_evicted];
+		next_evicted = (next_evicted + 1) % MAX_SCALED_MASKS;
+	}
+
+	const vec2 size = abs(scale);
+	entry->scale = scale;
+	entry->columns = std::max(1, (int)ceil(size.x / WORLD_CELL_SIZE));
+	entry->rows = std::max(1, (int)ceil(size.y / WORLD_CELL_SIZE));
+	entry->words = (entry->columns + COLUMNS - 1) / COLUMNS;
+	entry->bits.assign((size_t)entry->words * entry->rows, 0);
+
+	// A cell is covered if any of the blocks it overlaps is, such that no contact is lost.
+	// Cell k spans [k, k + 1) * WORLD_CELL_SIZE from the bounding box minimum, a negative scale mirrors.
+	std::vector<uint64_t> column_blocks(entry->columns, 0);
+	for (int c = 0; c < entry->columns; c++)
+	{
+		float x0 = (c * WORLD_CELL_SIZE - size.x / 2) / scale.x;
+		float x1 = ((c + 1) * WORLD_CELL_SIZE - size.x / 2) / scale.x;
+		int first, last;
+		if (get_block_range(std::min(x0, x1), std::max(x0, x1), COLUMNS, first, last))
+			column_blocks[c] = bit_range(first, last);
+	}
+	for (int r = 0; r < entry->rows; r++)
+	{
+		float y0 = (r * WORLD_CELL_SIZE - size.y / 2) / scale.y;
+		float y1 = ((r + 1) * WORLD_CELL_SIZE - size.y / 2) / scale.y;
+		int first, last;
+		if (!get_block_range(std::min(y0, y1), std::max(y0, y1), rows, first, last))
+			continue;
+		uint64_t row = 0;
+		for (int k = first; k <= last; k++)
+			row |= bits[k];
+		if (row == 0)
+			continue;
+		for (int c = 0; c < entry->columns; c++)
+			if (row & column_blocks[c])
+				entry->bits[(size_t)(c / COLUMNS) * entry->rows + r] |= 1ull << (c % COLUMNS);
+	}
+	return *entry;
+}
+
+bool SpriteMask::overlaps(const Motion& motion, const SpriteMask& other, const Motion& other_motion) const
+{
+	assert(supports(motion) && supports(other_motion));
+	if (empty() || other.empty())
+		return false;
+
+	const vec2 scale_a = get_upright_scale(motion);
+	const vec2 scale_b = get_upright_scale(other_motion);
+	const Scaled* a = &get_scaled(scale_a);
+	const Scaled& b = other.get_scaled(scale_b);
+	if (a->scale != scale_a)
+		a = &get_scaled(scale_a); // evicted by the other lookup, both are the same mask
+
+	// Cell (c, r) of a is cell (c - dx, r - dy) of b
+	const vec2 min_a = motion.position - abs(scale_a) / 2.f;
+	const vec2 min_b = other_motion.position - abs(scale_b) / 2.f;
+	const int dx = (int)lround((min_b.x - min_a.x) / WORLD_CELL_SIZE);
+	const int dy = (int)lround((min_b.y - min_a.y) / WORLD_CELL_SIZE);
+
+	const int r0 = std::max(0, dy), r1 = std::min(a->rows, b.rows + dy);
+	const int c0 = std::max(0, dx), c1 = std::min(a->columns, b.columns + dx);
+	if (r0 >= r1 || c0 >= c1)
+		return false;
+
+	// Every word of a is compared with the 64 columns of b it lines up with, which straddle two words of b
+	for (int w = c0 / COLUMNS; w <= (c1 - 1) / COLUMNS; w++)
+	{
+		const int start = w * COLUMNS - dx; // column of b at bit 0 of the word
+		const int q = start >= 0 ? start / COLUMNS : -((-start + COLUMNS - 1) / COLUMNS);
+		const int shift = start - q * COLUMNS;
+		const uint64_t* lo = q >= 0 && q < b.words ? &b.bits[(size_t)q * b.rows + (r0 - dy)] : nullptr;
+		const uint64_t* hi = shift != 0 && q + 1 >= 0 && q + 1 < b.words ? &b.bits[(size_t)(q + 1) * b.rows + (r0 - dy)] : nullptr;
+		if (!lo && !hi)
+			continue;
+		if (any_common_bits(&a->bits[(size_t)w * a->rows + r0], lo, hi, shift, r1 - r0))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,220 @@
+// internal
+#include "steering.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "simd.hpp"
+
+// Arriving agents slow down linearly within this distance of the target
+const float ARRIVE_RADIUS = 100.f;
+// Fleeing agents only react to threats within this distance
+const float FLEE_RADIUS = 200.f;
+// The wander target is on a circle of WANDER_RADIUS, WANDER_DISTANCE ahead of the agent
+const float WANDER_DISTANCE = 60.f;
+const float WANDER_RADIUS = 30.f;
+// Largest change of the angle on the wander circle, in radians per second
+const float WANDER_JITTER = 4.f;
+// Agents closer than this to the left or right window border are pushed back, growing to max_force at the border
+const float WALL_MARGIN = 60.f;
+// Keeps the normalizations finite for zero vectors
+const float STEERING_EPSILON = 1e-6f;
+
+void SteeringStreams::resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	target_x.resize(count);
+	target_y.resize(count);
+	threat_x.resize(count);
+	threat_y.resize(count);
+	wander_x.resize(count);
+	wander_y.resize(count);
+	max_speed.resize(count);
+	max_force.resize(count);
+	seek.resize(count);
+	flee.resize(count);
+	arrive.resize(count);
+	wander.resize(count);
+	avoid_walls.resize(count);
+}
+
+void SteeringStreams::gather(float step_seconds)
+{
+	ComponentContainer<SteeringAgent>& agents = registry.steeringAgents;
+	indices.clear();
+	for (uint k = 0; k < agents.components.size(); k++)
+		if (registry.motions.has(agents.entities[k]))
+			indices.push_back(k);
+
+	resize(indices.size());
+	for (uint k = 0; k < indices.size(); k++)
+	{
+		SteeringAgent& agent = agents.components[indices[k]];
+		const Motion& motion = registry.motions.get(agents.entities[indices[k]]);
+		x[k] = motion.position.x;
+		y[k] = motion.position.y;
+		vx[k] = motion.velocity.x;
+		vy[k] = motion.velocity.y;
+		target_x[k] = agent.target.x;
+		target_y[k] = agent.target.y;
+		threat_x[k] = agent.threat.x;
+		threat_y[k] = agent.threat.y;
+		max_speed[k] = agent.max_speed;
+		max_force[k] = agent.max_force;
+		seek[k] = agent.seek;
+		flee[k] = agent.flee;
+		arrive[k] = agent.arrive;
+		wander[k] = agent.wander;
+		avoid_walls[k] = agent.avoid_walls;
+
+		// The wander target drifts randomly along its circle
+		if (agent.wander != 0.f)
+			agent.wander_angle += (2.f * uniform_dist(rng) - 1.f) * WANDER_JITTER * step_seconds;
+		wander_x[k] = cos(agent.wander_angle);
+		wander_y[k] = sin(agent.wander_angle);
+	}
+}
+
+void SteeringStreams::scatter()
+{
+	ComponentContainer<SteeringAgent>& agents = registry.steeringAgents;
+	for (uint k = 0; k < indices.size(); k++)
+		registry.motions.get(agents.entities[indices[k]]).velocity = { vx[k], vy[k] };
+}
+
+static void steer_range(SteeringStreams& s, size_t begin, size_t end, float step_seconds)
+{
+	const float right_wall = window_width_px - WALL_MARGIN;
+	for (size_t i = begin; i < end; i++)
+	{
+		const float x = s.x[i], y = s.y[i];
+		const float vx = s.vx[i], vy = s.vy[i];
+		const float speed = s.max_speed[i];
+
+		// seek at full speed, arrive slowing down close to the target
+		const float dx = s.target_x[i] - x, dy = s.target_y[i] - y;
+		const float distance = sqrtf(std::max(dx * dx + dy * dy, STEERING_EPSILON));
+		const float to_target = speed / distance;
+		const float seek_x = dx * to_target - vx, seek_y = dy * to_target - vy;
+		const float ramp = std::min(distance / ARRIVE_RADIUS, 1.f);
+		const float arrive_x = dx * to_target * ramp - vx, arrive_y = dy * to_target * ramp - vy;
+
+		// flee from a close threat
+		const float ax = x - s.threat_x[i], ay = y - s.threat_y[i];
+		const float threat_sq = ax * ax + ay * ay;
+		const float from_threat = speed / sqrtf(std::max(threat_sq, STEERING_EPSILON));
+		const bool threatened = threat_sq < FLEE_RADIUS * FLEE_RADIUS;
+		const float flee_x = threatened ? ax * from_threat - vx : 0.f;
+		const float flee_y = threatened ? ay * from_threat - vy : 0.f;
+
+		// wander towards a point on the circle ahead
+		const float current_speed = sqrtf(std::max(vx * vx + vy * vy, STEERING_EPSILON));
+		const float hx = vx / current_speed * WANDER_DISTANCE + s.wander_x[i] * WANDER_RADIUS;
+		const float hy = vy / current_speed * WANDER_DISTANCE + s.wander_y[i] * WANDER_RADIUS;
+		const float to_wander = speed / sqrtf(std::max(hx * hx + hy * hy, STEERING_EPSILON));
+		const float wander_x = hx * to_wander - vx, wander_y = hy * to_wander - vy;
+
+		// push back from the left and right walls
+		const float wall_x = (std::max(WALL_MARGIN - x, 0.f) - std::max(x - right_wall, 0.f)) * (s.max_force[i] / WALL_MARGIN);
+
+		float fx = s.seek[i] * seek_x + s.flee[i] * flee_x + s.arrive[i] * arrive_x + s.wander[i] * wander_x + s.avoid_walls[i] * wall_x;
+		float fy = s.seek[i] * seek_y + s.flee[i] * flee_y + s.arrive[i] * arrive_y + s.wander[i] * wander_y;
+		const float force_scale = std::min(s.max_force[i] / sqrtf(std::max(fx * fx + fy * fy, STEERING_EPSILON)), 1.f);
+		const float nvx = vx + fx * force_scale * step_seconds;
+		const float nvy = vy + fy * force_scale * step_seconds;
+		const float speed_scale = std::min(speed / sqrtf(std::max(nvx * nvx + nvy * nvy, STEERING_EPSILON)), 1.f);
+		s.vx[i] = nvx * speed_scale;
+		s.vy[i] = nvy * speed_scale;
+	}
+}
+
+void steer_agents_scalar(SteeringStreams& streams, float step_seconds)
+{
+	steer_range(streams, 0, streams.size(), step_seconds);
+}
+
+void steer_agents(SteeringStreams& streams, float step_seconds)
+{
+	steer_agents(streams, 0, streams.size(), step_seconds);
+}
+
+void steer_agents(SteeringStreams& streams, size_t begin, size_t end, float step_seconds)
+{
+	size_t i = begin;
+
+#if SIMD_WIDTH > 1
+	const size_t simd_end = end - (end - begin) % SIMD_WIDTH;
+	const simd_float step = simd_set1(step_seconds);
+	const simd_float zero = simd_set1(0.f);
+	const simd_float one = simd_set1(1.f);
+	const simd_float epsilon = simd_set1(STEERING_EPSILON);
+	const simd_float arrive_radius = simd_set1(ARRIVE_RADIUS);
+	const simd_float flee_radius_sq = simd_set1(FLEE_RADIUS * FLEE_RADIUS);
+	const simd_float wander_distance = simd_set1(WANDER_DISTANCE);
+	const simd_float wander_radius = simd_set1(WANDER_RADIUS);
+	const simd_float margin = simd_set1(WALL_MARGIN);
+	const simd_float right_wall = simd_set1(window_width_px - WALL_MARGIN);
+	auto norm = [&](simd_float a, simd_float b) {
+		return simd_sqrt(simd_max(simd_add(simd_mul(a, a), simd_mul(b, b)), epsilon));
+	};
+	for (; i < simd_end; i += SIMD_WIDTH)
+	{
+		const simd_float x = simd_load(&streams.x[i]);
+		const simd_float y = simd_load(&streams.y[i]);
+		const simd_float vx = simd_load(&streams.vx[i]);
+		const simd_float vy = simd_load(&streams.vy[i]);
+		const simd_float speed = simd_load(&streams.max_speed[i]);
+		const simd_float max_force = simd_load(&streams.max_force[i]);
+
+		// seek and arrive
+		const simd_float dx = simd_sub(simd_load(&streams.target_x[i]), x);
+		const simd_float dy = simd_sub(simd_load(&streams.target_y[i]), y);
+		const simd_float distance = norm(dx, dy);
+		const simd_float to_target = simd_div(speed, distance);
+		const simd_float seek_x = simd_sub(simd_mul(dx, to_target), vx);
+		const simd_float seek_y = simd_sub(simd_mul(dy, to_target), vy);
+		const simd_float ramp = simd_min(simd_div(distance, arrive_radius), one);
+		const simd_float arrive_x = simd_sub(simd_mul(simd_mul(dx, to_target), ramp), vx);
+		const simd_float arrive_y = simd_sub(simd_mul(simd_mul(dy, to_target), ramp), vy);
+
+		// flee
+		const simd_float ax = simd_sub(x, simd_load(&streams.threat_x[i]));
+		const simd_float ay = simd_sub(y, simd_load(&streams.threat_y[i]));
+		const simd_float threat_sq = simd_add(simd_mul(ax, ax), simd_mul(ay, ay));
+		const simd_float from_threat = simd_div(speed, simd_sqrt(simd_max(threat_sq, epsilon)));
+		const simd_mask threatened = simd_lt(threat_sq, flee_radius_sq);
+		const simd_float flee_x = simd_select(threatened, simd_sub(simd_mul(ax, from_threat), vx), zero);
+		const simd_float flee_y = simd_select(threatened, simd_sub(simd_mul(ay, from_threat), vy), zero);
+
+		// wander
+		const simd_float current_speed = norm(vx, vy);
+		const simd_float hx = simd_add(simd_mul(simd_div(vx, current_speed), wander_distance), simd_mul(simd_load(&streams.wander_x[i]), wander_radius));
+		const simd_float hy = simd_add(simd_mul(simd_div(vy, current_speed), wander_distance), simd_mul(simd_load(&streams.wander_y[i]), wander_radius));
+		const simd_float to_wander = simd_div(speed, norm(hx, hy));
+		const simd_float wander_x = simd_sub(simd_mul(hx, to_wander), vx);
+		const simd_float wander_y = simd_sub(simd_mul(hy, to_wander), vy);
+
+		// walls
+		const simd_float push = simd_sub(simd_max(simd_sub(margin, x), zero), simd_max(simd_sub(x, right_wall), zero));
+		const simd_float wall_x = simd_mul(push, simd_div(max_force, margin));
+
+		// blend, same order of operations as steer_range()
+		const simd_float seek = simd_load(&streams.seek[i]);
+		const simd_float flee = simd_load(&streams.flee[i]);
+		const simd_float arrive = simd_load(&streams.arrive[i]);
+		const simd_float wander = simd_load(&streams.wander[i]);
+		simd_float fx = simd_add(simd_add(simd_add(simd_add(simd_mul(seek, seek_x), simd_mul(flee, flee_x)),
+			simd_mul(arrive, arrive_x)), simd_mul(wander, wander_x)), simd_mul(simd_load(&streams.avoid_walls[i]), wall_x));
+		simd_float fy = simd_add(simd_add(simd_add(simd_mul(seek, seek_y), simd_mul(flee, flee_y)),
+			simd_mul(arrive, arrive_y)), simd_mul(wander, wander_y));
+		const simd_float force_scale = simd_min(simd_div(max_force, norm(fx, fy)), one);
+		const simd_float nvx = simd_add(vx, simd_mul(simd_mul(fx, force_scale), step));
+		const simd_float nvy = simd_add(vy, simd_mul(simd_mul(fy, force_scale), step));
+		const simd_float speed_scale = simd_min(simd_div(speed, norm(nvx, nvy)), one);
+		simd_store(&streams.vx[i], simd_mul(nvx, speed_scale));
+		simd_store(&streams.vy[i], simd_mul(nvy, speed_scale));
+	}
+#endif
+
+	steer_range(streams, i, end, step_seconds);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// stlib
+#include <random>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Structure-of-arrays copy of the SteeringAgent components that have a Motion, slot k
+// corresponds to registry.steeringAgents.components[indices[k]]. The wander offsets are drawn
+// when gathering, such that the kernel itself has no state besides the streams.
+struct SteeringStreams
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> target_x;
+	std::vector<float> target_y;
+	std::vector<float> threat_x;
+	std::vector<float> threat_y;
+	std::vector<float> wander_x; // unit offset on the wander circle
+	std::vector<float> wander_y;
+	std::vector<float> max_speed;
+	std::vector<float> max_force;
+
+	// weights
+	std::vector<float> seek;
+	std::vector<float> flee;
+	std::vector<float> arrive;
+	std::vector<float> wander;
+	std::vector<float> avoid_walls;
+
+	std::vector<unsigned int> indices;
+
+	void resize(size_t count);
+	size_t size() const { return x.size(); }
+
+	// Copy from the agents and their motions, and back to the velocities of the motions
+	void gather(float step_seconds);
+	void scatter();
+
+private:
+	std::default_random_engine rng;
+	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
+};
+
+// Blends the seek, flee, arrive, wander and wall avoidance forces of every agent by its
+// weights, truncates the sum to max_force and the new velocity to max_speed. One pass over
+// contiguous floats, 8 (AVX2) or 4 (SSE2/NEON) agents at a time.
+void steer_agents(SteeringStreams& streams, float step_seconds);
+// Same for the agents [begin, end) only, for splitting the streams across threads
+void steer_agents(SteeringStreams& streams, size_t begin, size_t end, float step_seconds);
+
+// Scalar reference with the identical results
+void steer_agents_scalar(SteeringStreams& streams, float step_seconds);
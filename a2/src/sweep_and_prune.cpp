@@ -0,0 +1,113 @@
+// internal
+#include "sweep_and_prune.hpp"
+
+const int SweepAndPrune::NULL_PROXY;
+
+void SweepAndPrune::clear()
+{
+	proxies.clear();
+	free_proxies.clear();
+	endpoints.clear();
+	active.clear();
+	has_removed = false;
+	swap_count = 0;
+}
+
+int SweepAndPrune::create_proxy(const AABB& aabb, unsigned int user_data)
+{
+	int proxy_id;
+	if (free_proxies.empty())
+	{
+		proxy_id = (int)proxies.size();
+		proxies.push_back(Proxy());
+	}
+	else
+	{
+		proxy_id = free_proxies.back();
+		free_proxies.pop_back();
+	}
+
+	Proxy& proxy = proxies[proxy_id];
+	proxy.aabb = aabb;
+	proxy.user_data = user_data;
+	proxy.alive = true;
+
+	// New endpoints are appended, the insertion sort moves them into place
+	endpoints.push_back({ aabb.min.x, (unsigned int)proxy_id << 1 });
+	endpoints.push_back({ aabb.max.x, ((unsigned int)proxy_id << 1) | 1 });
+	return proxy_id;
+}
+
+void SweepAndPrune::destroy_proxy(int proxy_id)
+{
+	assert(proxies[proxy_id].alive);
+	// The endpoints are removed in one pass before the next sweep
+	proxies[proxy_id].alive = false;
+	free_proxies.push_back(proxy_id);
+	has_removed = true;
+}
+
+bool SweepAndPrune::move_proxy(int proxy_id, const AABB& aabb, vec2 displacement)
+{
+	(void)displacement; // no fattening, the intervals are always tight
+	assert(proxies[proxy_id].alive);
+	proxies[proxy_id].aabb = aabb;
+	return true;
+}
+
+void SweepAndPrune::update_endpoints()
+{
+	// Drop the endpoints of destroyed proxies, this keeps the remaining ones sorted.
+	// Note, a proxy id may have been re-used since, then its endpoints appear twice
+	// and the older (already sorted) pair is dropped by the second check.
+	if (has_removed)
+	{
+		std::vector<unsigned char> seen(proxies.size(), 0);
+		for (int i = (int)endpoints.size() - 1; i >= 0; i--)
+		{
+			const Endpoint& endpoint = endpoints[i];
+			unsigned char bit = endpoint.is_max() ? 2 : 1;
+			bool keep = proxies[endpoint.proxy_id()].alive && !(seen[endpoint.proxy_id()] & bit);
+			seen[endpoint.proxy_id()] |= bit;
+			if (!keep)
+				endpoints[i].packed = ~0u;
+		}
+		endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(),
+			[](const Endpoint& endpoint) { return endpoint.packed == ~0u; }), endpoints.end());
+		has_removed = false;
+	}
+
+	// Refresh the endpoint values from the proxies
+	for (Endpoint& endpoint : endpoints)
+	{
+		const AABB& aabb = proxies[endpoint.proxy_id()].aabb;
+		endpoint.value = endpoint.is_max() ? aabb.max.x : aabb.min.x;
+	}
+
+	// Insertion sort, close to O(n) thanks to temporal coherence.
+	// Min endpoints go before max endpoints of equal value, such that touching intervals overlap.
+	auto less = [](const Endpoint& a, const Endpoint& b) {
+		return a.value < b.value || (a.value == b.value && !a.is_max() && b.is_max());
+	};
+	swap_count = 0;
+	for (size_t i = 1; i < endpoints.size(); i++)
+	{
+		Endpoint key = endpoints[i];
+		size_t j = i;
+		while (j > 0 && less(key, endpoints[j - 1]))
+		{
+			endpoints[j] = endpoints[j - 1];
+			j--;
+		}
+		swap_count += i - j;
+		endpoints[j] = key;
+	}
+}
+
+void SweepAndPrune::prepare_sweep()
+{
+	update_endpoints();
+	for (size_t k = 0; k < endpoints.size(); k++)
+		if (endpoints[k].is_max())
+			proxies[endpoints[k].proxy_id()].max_endpoint = (unsigned int)k;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+// stlib
+#include <vector>
+
+#include "common.hpp"
+#include "aabb_tree.hpp" // AABB
+
+// Incremental sort-and-sweep broadphase along the x-axis.
+// The interval endpoints of all proxies are kept in a persistent array that stays
+// sorted across steps. Since entities only move a little between two frames the
+// array is almost sorted and insertion sort repairs it in close to linear time.
+// The sweep then emits all pairs whose x-intervals and y-intervals overlap.
+class SweepAndPrune
+{
+public:
+	static const int NULL_PROXY = -1;
+
+	// Same interface as AABBTree, such that the physics system can use either
+	int create_proxy(const AABB& aabb, unsigned int user_data);
+	void destroy_proxy(int proxy_id);
+	// Updates the interval, the endpoint order is repaired lazily in query_pairs()
+	bool move_proxy(int proxy_id, const AABB& aabb, vec2 displacement);
+
+	unsigned int get_user_data(int proxy_id) const { return proxies[proxy_id].user_data; }
+	void set_user_data(int proxy_id, unsigned int user_data) { proxies[proxy_id].user_data = user_data; }
+	const AABB& get_aabb(int proxy_id) const { return proxies[proxy_id].aabb; }
+
+	// Calls callback(user_data_a, user_data_b) once for every pair of overlapping proxies
+	template <class Callback>
+	void query_pairs(Callback callback);
+
+	// Parallel sweep: prepare_sweep() sorts the endpoints, then the endpoint range can be split
+	// into slabs along the x-axis that are swept independently. The pairs of a slab are the ones
+	// whose later starting proxy starts in [begin, end), so every pair is reported by exactly one slab.
+	// active is scratch space owned by the caller.
+	void prepare_sweep();
+	size_t endpoint_count() const { return endpoints.size(); }
+	template <class Callback>
+	void query_pairs(size_t begin, size_t end, std::vector<int>& active, Callback callback) const;
+
+	size_t proxy_count() const { return endpoints.size() / 2; }
+	// Number of endpoint swaps done by the last insertion sort, a measure of the temporal coherence
+	size_t last_swap_count() const { return swap_count; }
+	void clear();
+
+private:
+	struct Proxy
+	{
+		AABB aabb;
+		unsigned int user_data = 0;
+		bool alive = false;
+		// Position of the max endpoint in the sorted array, set by prepare_sweep()
+		unsigned int max_endpoint = 0;
+	};
+
+	struct Endpoint
+	{
+		float value;
+		// proxy id, the lowest bit encodes whether this is the max endpoint
+		unsigned int packed;
+
+		int proxy_id() const { return (int)(packed >> 1); }
+		bool is_max() const { return (packed & 1) != 0; }
+	};
+
+	void update_endpoints();
+
+	std::vector<Proxy> proxies;
+	std::vector<int> free_proxies;
+	std::vector<Endpoint> endpoints;
+	std::vector<int> active;
+	bool has_removed = false;
+	size_t swap_count = 0;
+};
+
+template <class Callback>
+void SweepAndPrune::query_pairs(Callback callback)
+{
+	prepare_sweep();
+	query_pairs(0, endpoints.size(), active, callback);
+}
+
+template <class Callback>
+void SweepAndPrune::query_pairs(size_t begin, size_t end, std::vector<int>& active, Callback callback) const
+{
+	// The proxies that started before the slab and are still open
+	active.clear();
+	for (size_t k = 0; k < begin; k++)
+	{
+		const Endpoint& endpoint = endpoints[k];
+		if (!endpoint.is_max() && proxies[endpoint.proxy_id()].max_endpoint > begin)
+			active.push_back(endpoint.proxy_id());
+	}
+
+	for (size_t k = begin; k < end; k++)
+	{
+		const Endpoint& endpoint = endpoints[k];
+		if (endpoint.is_max())
+			continue; // the proxy is dropped from the active list by the next min endpoint
+
+		// Entering the interval, all active proxies that didn't end yet overlap along x
+		int proxy_id = endpoint.proxy_id();
+		const Proxy& proxy = proxies[proxy_id];
+		size_t kept = 0;
+		for (int other : active)
+		{
+			const Proxy& other_proxy = proxies[other];
+			if (other_proxy.max_endpoint < k)
+				continue;
+			active[kept++] = other;
+			if (proxy.aabb.min.y <= other_proxy.aabb.max.y && other_proxy.aabb.min.y <= proxy.aabb.max.y)
+				callback(proxy.user_data, other_proxy.user_data);
+		}
+		active.resize(kept);
+		active.push_back(proxy_id);
+	}
+}
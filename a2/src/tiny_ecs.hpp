@@ -46,6 +46,10 @@ public:
 	// The corresponding entities
 	std::vector<Entity> entities;
 
+	// Changes whenever a component is inserted or removed, such that a system can tell that the
+	// set of entities changed without comparing it
+	unsigned int generation = 0;
+
 	// Constructor that registers the type
 	ComponentContainer()
 	{
@@ -60,6 +64,7 @@ public:
 		map_entity_componentID[e] = (unsigned int)components.size();
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
+		generation++;
 		return components.back();
 	};
 
@@ -102,6 +107,7 @@ public:
 			map_entity_componentID.erase(e);
 			components.pop_back();
 			entities.pop_back();
+			generation++;
 			// Note, one could mark the id for re-use
 		}
 	};
@@ -112,6 +118,7 @@ public:
 		map_entity_componentID.clear();
 		components.clear();
 		entities.clear();
+		generation++;
 	}
 
 	// Report the number of components of type 'Component'
@@ -14,9 +14,10 @@ public:
 	// TODO: A1 add a LightUp component
 	ComponentContainer<DeathTimer> deathTimers;
 	ComponentContainer<Motion> motions;
-	ComponentContainer<Collision> collisions;
+	ComponentContainer<PreviousMotion> previousMotions;
 	ComponentContainer<Player> players;
 	ComponentContainer<Mesh*> meshPtrs;
+	ComponentContainer<SpriteMask*> spriteMaskPtrs;
 	ComponentContainer<RenderRequest> renderRequests;
 	ComponentContainer<ScreenState> screenStates;
 	ComponentContainer<Eatable> eatables;
@@ -24,6 +25,13 @@ public:
 	ComponentContainer<DebugComponent> debugComponents;
 	ComponentContainer<vec3> colors;
 	ComponentContainer<Lightup> lightup;
+	ComponentContainer<CollisionFilter> collisionFilters;
+	ComponentContainer<StaticBody> staticBodies;
+	ComponentContainer<SteeringAgent> steeringAgents;
+	ComponentContainer<BehaviorAgent> behaviorAgents;
+	ComponentContainer<AILevel> aiLevels;
+	ComponentContainer<Boid> boids;
+	ComponentContainer<EscapeRoute> escapeRoutes;
 
 	// constructor that adds all containers for looping over them
 	// IMPORTANT: Don't forget to add any newly added containers!
@@ -32,9 +40,10 @@ public:
 		// TODO: A1 add a LightUp component
 		registry_list.push_back(&deathTimers);
 		registry_list.push_back(&motions);
-		registry_list.push_back(&collisions);
+		registry_list.push_back(&previousMotions);
 		registry_list.push_back(&players);
 		registry_list.push_back(&meshPtrs);
+		registry_list.push_back(&spriteMaskPtrs);
 		registry_list.push_back(&renderRequests);
 		registry_list.push_back(&screenStates);
 		registry_list.push_back(&eatables);
@@ -42,6 +51,13 @@ public:
 		registry_list.push_back(&debugComponents);
 		registry_list.push_back(&colors);
 		registry_list.push_back(&lightup);
+		registry_list.push_back(&collisionFilters);
+		registry_list.push_back(&staticBodies);
+		registry_list.push_back(&steeringAgents);
+		registry_list.push_back(&behaviorAgents);
+		registry_list.push_back(&aiLevels);
+		registry_list.push_back(&boids);
+		registry_list.push_back(&escapeRoutes);
 	}
 
 	void clear_all_components() {
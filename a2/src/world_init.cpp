@@ -20,6 +20,8 @@ Entity createChicken(RenderSystem* renderer, vec2 pos)
 	// Create and (empty) Chicken component to be able to refer to all eagles
 	//registry.lightup.emplace(entity);
 	registry.players.emplace(entity);
+	// The chicken is the only entity that cares about its collisions
+	registry.collisionFilters.insert(entity, { COLLISION_LAYER_PLAYER, COLLISION_LAYER_DEADLY | COLLISION_LAYER_EATABLE });
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::TEXTURE_COUNT, // TEXTURE_COUNT indicates that no txture is needed
@@ -37,6 +39,7 @@ Entity createBug(RenderSystem* renderer, vec2 position)
 	// Store a reference to the potentially re-used mesh object
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
+	registry.spriteMaskPtrs.emplace(entity, &renderer->getTextureMask(TEXTURE_ASSET_ID::BUG));
 
 	// Initialize the position, scale, and physics components
 	auto& motion = registry.motions.emplace(entity);
@@ -49,6 +52,11 @@ Entity createBug(RenderSystem* renderer, vec2 position)
 
 	// Create an (empty) Bug component to be able to refer to all bug
 	registry.eatables.emplace(entity);
+	// Fast enough for the sideways speed the bugs spawn with
+	SteeringAgent& agent = registry.steeringAgents.emplace(entity);
+	agent.max_speed = 60.f;
+	registry.aiLevels.emplace(entity);
+	registry.collisionFilters.insert(entity, { COLLISION_LAYER_EATABLE, 0 });
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::BUG,
@@ -65,6 +73,7 @@ Entity createEagle(RenderSystem* renderer, vec2 position)
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
 	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
+	registry.spriteMaskPtrs.emplace(entity, &renderer->getTextureMask(TEXTURE_ASSET_ID::EAGLE));
 
 	// Initialize the motion
 	auto& motion = registry.motions.emplace(entity);
@@ -77,6 +86,12 @@ Entity createEagle(RenderSystem* renderer, vec2 position)
 
 	// Create and (empty) Eagle component to be able to refer to all eagles
 	registry.deadlys.emplace(entity);
+	// The eagles swarm down in waves, turned back at the walls
+	registry.boids.emplace(entity).cruise = motion.velocity;
+	SteeringAgent& agent = registry.steeringAgents.emplace(entity);
+	agent.max_speed = 160.f;
+	agent.avoid_walls = 1.f;
+	registry.collisionFilters.insert(entity, { COLLISION_LAYER_DEADLY, 0 });
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::EAGLE,
@@ -105,6 +120,8 @@ Entity createLine(vec2 position, vec2 scale)
 	motion.scale = scale;
 
 	registry.debugComponents.emplace(entity);
+	// Debug lines never collide
+	registry.collisionFilters.insert(entity, { COLLISION_LAYER_DEBUG, 0 });
 	return entity;
 }
 
@@ -121,6 +138,9 @@ Entity createEgg(vec2 pos, vec2 size)
 
 	// Create and (empty) Chicken component to be able to refer to all eagles
 	registry.deadlys.emplace(entity);
+	registry.collisionFilters.insert(entity, { COLLISION_LAYER_DEADLY | COLLISION_LAYER_STATIC, 0 });
+	// Eggs lie on the ground and never move
+	registry.staticBodies.emplace(entity);
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::TEXTURE_COUNT, // TEXTURE_COUNT indicates that no txture is needed
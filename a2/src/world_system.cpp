@@ -8,6 +8,7 @@
 #include <math.h>
 
 #include "physics_system.hpp"
+#include "contact_manager.hpp"
 
 // Game configuration
 const size_t MAX_EAGLES = 15;
@@ -120,6 +121,13 @@ void WorldSystem::init(RenderSystem* renderer_arg) {
 	Mix_PlayMusic(background_music, -1);
 	fprintf(stderr, "Loaded music\n");
 
+	// For now, we are only interested in collisions that involve the chicken
+	contact_manager.clear_handlers();
+	contact_manager.add_handler(CONTACT_EVENT_ID::BEGIN, COLLISION_LAYER_PLAYER, COLLISION_LAYER_DEADLY,
+		[this](const std::vector<Contact>& contacts) { on_player_deadly(contacts); });
+	contact_manager.add_handler(CONTACT_EVENT_ID::BEGIN, COLLISION_LAYER_PLAYER, COLLISION_LAYER_EATABLE,
+		[this](const std::vector<Contact>& contacts) { on_player_eatable(contacts); });
+
 	// Set all states to default
     restart_game();
 }
@@ -274,79 +282,55 @@ void WorldSystem::restart_game() {
 
 // Compute collisions between entities
 void WorldSystem::handle_collisions() {
-	// Loop over all collisions detected by the physics system
-	auto& collisionsRegistry = registry.collisions; // TODO: @Tim, is the reference here needed?
-	for (uint i = 0; i < collisionsRegistry.components.size(); i++) {
-		// The entity and its collider
-		Entity entity = collisionsRegistry.entities[i];
-		Entity entity_other = collisionsRegistry.components[i].other;
-		//registry.players.get(entity).has_eaten = false;
-
-		// For now, we are only interested in collisions that involve the chicken
-		if (registry.players.has(entity)) {
-			Player& player = registry.players.get(entity);
-			Motion& motion = registry.motions.get(entity);
-
-
-			// Checking Player - Deadly collisions
-			if (registry.deadlys.has(entity_other)) {
-				// initiate death unless already dying
-				if (!registry.deathTimers.has(entity)) {
-					// Scream, reset timer, and make the chicken sink
-					registry.deathTimers.emplace(entity);
-					Mix_PlayChannel(-1, chicken_dead_sound, 0);
-					// !!! TODO A1: change the chicken orientation and color on death
-					//Turn 180 to fall downwards using pi, then put x veloivty to 0 and fall down
-					motion.angle = M_PI; 
-					motion.velocity = { 0,200 };
-					// set is_alive to dead
-					registry.players.get(entity).is_alive = false;
-					motion.in_motion = false; 
-					if (!player.is_alive) {
-						// not alive chicken is red 
-						registry.colors.get(entity) = { 1.0,0,0 };
-					}
-					
-					
-
-				}
-			}
-			// Checking Player - Eatable collisions
-			else if (registry.eatables.has(entity_other)) {
-				if (!registry.deathTimers.has(entity)) {
-					// chew, count points, and set the LightUp timer
-					registry.remove_all_components_of(entity_other);
-					Mix_PlayChannel(-1, chicken_eat_sound, 0);
-					registry.players.get(entity).has_eaten = true;
-					if (!registry.lightup.has(entity)) {
-						registry.lightup.emplace(entity);
-					}
-
-
-					++points;
-
-					// after ++ points set back to false
-					// add it 
-					//float counter = registry.deathTimers.get(entity).counter_ms;
-					// set eaten to true 
-			
-					//registry.lightup.get(entity).counter_ms= 
-					
-					//registry.lightup.get(entity).counter_ms = 0; 
-					//registry.lightup.get(entity).counter_ms=0;
-					
-					// !!! TODO A1: create a new struct called LightUp in components.hpp and add an instance to the chicken entity by modifying the ECS registry
-					//registry.lightup.emplace(entity);
-					//registry.lightup.get(entity).counter_ms =0;
-				}
-				
+	// The contacts that started in this simulation step were sorted into the buckets of the
+	// handlers registered in init(), the ongoing ones were handled before
+	contact_manager.dispatch();
+}
+
+// Player - Deadly contacts, the entity is the chicken
+void WorldSystem::on_player_deadly(const std::vector<Contact>& contacts) {
+	for (const Contact& contact : contacts) {
+		Entity entity = contact.entity;
+		Player& player = registry.players.get(entity);
+		Motion& motion = registry.motions.get(entity);
+
+		// initiate death unless already dying
+		if (!registry.deathTimers.has(entity)) {
+			// Scream, reset timer, and make the chicken sink
+			registry.deathTimers.emplace(entity);
+			Mix_PlayChannel(-1, chicken_dead_sound, 0);
+			// !!! TODO A1: change the chicken orientation and color on death
+			//Turn 180 to fall downwards using pi, then put x veloivty to 0 and fall down
+			motion.angle = M_PI; 
+			motion.velocity = { 0,200 };
+			// set is_alive to dead
+			player.is_alive = false;
+			motion.in_motion = false; 
+			if (!player.is_alive) {
+				// not alive chicken is red 
+				registry.colors.get(entity) = { 1.0,0,0 };
 			}
 		}
 	}
-	
+}
 
-	// Remove all collisions from this simulation step
-	registry.collisions.clear();
+// Player - Eatable contacts, the entity is the chicken
+void WorldSystem::on_player_eatable(const std::vector<Contact>& contacts) {
+	for (const Contact& contact : contacts) {
+		Entity entity = contact.entity;
+		Entity entity_other = contact.other;
+		if (!registry.deathTimers.has(entity)) {
+			// chew, count points, and set the LightUp timer
+			registry.remove_all_components_of(entity_other);
+			Mix_PlayChannel(-1, chicken_eat_sound, 0);
+			registry.players.get(entity).has_eaten = true;
+			if (!registry.lightup.has(entity)) {
+				registry.lightup.emplace(entity);
+			}
+
+			++points;
+		}
+	}
 }
 
 // Should the game be over ?
@@ -443,6 +427,16 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		printf("Current speed = %f\n", current_speed);
 	}
 	current_speed = fmax(0.f, current_speed);
+
+	// Control how many AI ticks pass between AI goal path updates with `[` `]`
+	if (action == GLFW_RELEASE && key == GLFW_KEY_LEFT_BRACKET && ai_update_ticks > 1) {
+		ai_update_ticks--;
+		printf("AI update every %u AI ticks\n", ai_update_ticks);
+	}
+	if (action == GLFW_RELEASE && key == GLFW_KEY_RIGHT_BRACKET) {
+		ai_update_ticks++;
+		printf("AI update every %u AI ticks\n", ai_update_ticks);
+	}
 }
 
 void WorldSystem::on_mouse_move(vec2 mouse_position) {
@@ -12,6 +12,7 @@
 #include <SDL_mixer.h>
 
 #include "render_system.hpp"
+#include "contact_manager.hpp"
 
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
@@ -37,11 +38,18 @@ public:
 
 	// Should the game be over ?
 	bool is_over()const;
+
+	// Frames between the AI goal path updates, user-controllable
+	unsigned int get_ai_update_ticks() const { return ai_update_ticks; }
 private:
 	// Input callback functions
 	void on_key(int key, int, int action, int mod);
 	void on_mouse_move(vec2 pos);
 
+	// Contact handlers, see handle_collisions()
+	void on_player_deadly(const std::vector<Contact>& contacts);
+	void on_player_eatable(const std::vector<Contact>& contacts);
+
 	// restart level
 	void restart_game();
 
@@ -54,6 +62,7 @@ private:
 	// Game state
 	RenderSystem* renderer;
 	float current_speed;
+	unsigned int ai_update_ticks = 1; // of the AI clock, see AI_TICK_HZ in main.cpp
 	float next_eagle_spawn;
 	float next_bug_spawn;
 	Entity player_chicken;